@@ -0,0 +1,198 @@
+/*
+ * Epoch based reclamation, shared by the programs that publish immutable versions through an atomic pointer.
+ * A pinned reader announces the global epoch it entered in, a replaced object is retired with the epoch of its
+ * replacement, and it is freed once every pinned reader has announced a later epoch.
+ *
+ * Threads register with a manager on their first Pin and keep their slot until they exit. A manager may be destroyed
+ * while threads that used it are still alive (main's own thread always is): the destructor detaches their thread
+ * states, so no thread_local ever points into a manager that is gone.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class EpochManager
+{
+public:
+    static constexpr unsigned kMaxThreads = 256;
+    static constexpr uint64_t kIdle = UINT64_MAX;
+
+    /* Keeps every object visible at construction time alive until destruction. Guards may nest. */
+    class Guard
+    {
+    public:
+        explicit Guard(EpochManager &manager) : m_Manager(manager) { m_Manager.Enter(); }
+        ~Guard() { m_Manager.Exit(); }
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        EpochManager &m_Manager;
+    };
+
+    EpochManager() = default;
+    EpochManager(const EpochManager &) = delete;
+    EpochManager &operator=(const EpochManager &) = delete;
+
+    ~EpochManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(RegistrationMutex());
+            for (auto &slot : m_aSlots)
+            {
+                if (slot.pOwner)
+                {
+                    slot.pOwner->pManager = nullptr;
+                    slot.pOwner->pSlot = nullptr;
+                    slot.pOwner = nullptr;
+                }
+            }
+        }
+        for (auto &retired : m_vRetired)
+            retired.second();
+    }
+
+    Guard Pin() { return Guard(*this); }
+
+    /* Called by writers after unlinking an object; deleter runs once no reader can still hold it. */
+    void Retire(std::function<void()> deleter)
+    {
+        std::lock_guard<std::mutex> lock(m_RetireMutex);
+        uint64_t nEpoch = m_nGlobalEpoch.fetch_add(1, std::memory_order_seq_cst);
+        m_vRetired.emplace_back(nEpoch, std::move(deleter));
+        CollectLocked();
+    }
+
+    /* Frees whatever has become unreachable. Returns the number of objects freed. */
+    size_t Collect()
+    {
+        std::lock_guard<std::mutex> lock(m_RetireMutex);
+        return CollectLocked();
+    }
+
+    size_t PendingCount()
+    {
+        std::lock_guard<std::mutex> lock(m_RetireMutex);
+        return m_vRetired.size();
+    }
+
+private:
+    struct ThreadState;
+
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> nEpoch{kIdle};
+        std::atomic<bool> bClaimed{false};
+        ThreadState *pOwner = nullptr; // guarded by RegistrationMutex()
+    };
+
+    /* Per thread registration; the slot is handed back when the thread exits or the manager goes away. */
+    struct ThreadState
+    {
+        EpochManager *pManager = nullptr;
+        Slot *pSlot = nullptr;
+        unsigned nDepth = 0;
+        ~ThreadState()
+        {
+            std::lock_guard<std::mutex> lock(RegistrationMutex());
+            Release();
+        }
+
+        /* Caller holds RegistrationMutex() */
+        void Release()
+        {
+            if (pSlot)
+            {
+                pSlot->pOwner = nullptr;
+                pSlot->bClaimed.store(false, std::memory_order_release);
+            }
+            pManager = nullptr;
+            pSlot = nullptr;
+        }
+    };
+
+    /* Orders registration against a manager's destruction and a thread's exit. Only taken off the fast path. */
+    static std::mutex &RegistrationMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    /* A thread is registered with one manager at a time, which is all a process with one registry needs. */
+    ThreadState &LocalState()
+    {
+        thread_local ThreadState state;
+        if (state.pManager != this)
+        {
+            if (state.nDepth != 0)
+                std::terminate(); // pinned in another manager
+            std::lock_guard<std::mutex> lock(RegistrationMutex());
+            state.Release();
+            for (auto &slot : m_aSlots)
+            {
+                bool bExpected = false;
+                if (slot.bClaimed.compare_exchange_strong(bExpected, true, std::memory_order_acq_rel))
+                {
+                    slot.pOwner = &state;
+                    state.pManager = this;
+                    state.pSlot = &slot;
+                    break;
+                }
+            }
+            if (!state.pSlot)
+                std::terminate(); // more concurrent readers than kMaxThreads
+        }
+        return state;
+    }
+
+    void Enter()
+    {
+        ThreadState &state = LocalState();
+        if (state.nDepth++ == 0)
+        {
+            state.pSlot->nEpoch.store(m_nGlobalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+    }
+
+    void Exit()
+    {
+        ThreadState &state = LocalState();
+        if (--state.nDepth == 0)
+            state.pSlot->nEpoch.store(kIdle, std::memory_order_release);
+    }
+
+    size_t CollectLocked()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t nOldest = kIdle;
+        for (const auto &slot : m_aSlots)
+            nOldest = std::min(nOldest, slot.nEpoch.load(std::memory_order_seq_cst));
+
+        size_t nFreed = 0;
+        auto it = std::remove_if(m_vRetired.begin(), m_vRetired.end(), [&](auto &retired)
+                                 {
+            if (retired.first >= nOldest)
+                return false;
+            retired.second();
+            ++nFreed;
+            return true; });
+        m_vRetired.erase(it, m_vRetired.end());
+        return nFreed;
+    }
+
+    std::atomic<uint64_t> m_nGlobalEpoch{1};
+    std::array<Slot, kMaxThreads> m_aSlots;
+
+    std::mutex m_RetireMutex;
+    std::vector<std::pair<uint64_t, std::function<void()>>> m_vRetired;
+};
@@ -0,0 +1,309 @@
+/*
+The Strategy Pattern with the strategy chosen by measurement.
+strategy_pattern.cpp swaps behaviors by hand. An AdaptiveSlot holds several equivalent implementations of one behavior
+and finds out which one is fastest on this machine for the calls it actually receives:
+ - Exploring: live calls go in batches of kBatchCalls to a candidate picked by a UCB1 style bandit (the arm with the
+   lowest optimistic cost estimate), and each batch is timed with one clock reading, so steady_clock::now() does not
+   dominate calls that take a few nanoseconds;
+ - Committed: after kExploreBatches batches the fastest candidate wins and calls go straight to it, the only overhead
+   is a counter decrement;
+ - every kReviewCalls committed calls the slot starts exploring again, in case the workload changed.
+Report() tells which candidate was chosen, when, and the timings behind it.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Family of Fly Behaviors: equivalent ways to fly along a route, returning the distance flown */
+struct Waypoint
+{
+    float fX, fY;
+};
+
+class IFlyBehavior
+{
+public:
+    virtual ~IFlyBehavior() = default;
+    virtual float Fly(const std::vector<Waypoint> &vRoute) = 0;
+};
+
+class FlyStraight : public IFlyBehavior
+{
+public:
+    float Fly(const std::vector<Waypoint> &vRoute) override
+    {
+        float fDistance = 0.0f;
+        for (size_t i = 1; i < vRoute.size(); ++i)
+        {
+            float fDx = vRoute[i].fX - vRoute[i - 1].fX, fDy = vRoute[i].fY - vRoute[i - 1].fY;
+            fDistance += std::sqrt(fDx * fDx + fDy * fDy);
+        }
+        return fDistance;
+    }
+};
+
+/* Four independent sums, so the additions do not wait on each other */
+class FlyInFormation : public IFlyBehavior
+{
+public:
+    float Fly(const std::vector<Waypoint> &vRoute) override
+    {
+        float aDistance[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        size_t i = 1;
+        for (; i + 3 < vRoute.size(); i += 4)
+            for (size_t lane = 0; lane < 4; ++lane)
+            {
+                float fDx = vRoute[i + lane].fX - vRoute[i + lane - 1].fX;
+                float fDy = vRoute[i + lane].fY - vRoute[i + lane - 1].fY;
+                aDistance[lane] += std::sqrt(fDx * fDx + fDy * fDy);
+            }
+        for (; i < vRoute.size(); ++i)
+        {
+            float fDx = vRoute[i].fX - vRoute[i - 1].fX, fDy = vRoute[i].fY - vRoute[i - 1].fY;
+            aDistance[0] += std::sqrt(fDx * fDx + fDy * fDy);
+        }
+        return (aDistance[0] + aDistance[1]) + (aDistance[2] + aDistance[3]);
+    }
+};
+
+class FlyCarefully : public IFlyBehavior
+{
+public:
+    float Fly(const std::vector<Waypoint> &vRoute) override
+    {
+        double dDistance = 0.0;
+        for (size_t i = 1; i < vRoute.size(); ++i)
+            dDistance += std::hypot(double(vRoute[i].fX) - vRoute[i - 1].fX, double(vRoute[i].fY) - vRoute[i - 1].fY);
+        return static_cast<float>(dDistance);
+    }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Picks the fastest of several equivalent behaviors from timed live calls. Not thread safe, one slot per thread. */
+template <typename Behavior>
+class AdaptiveSlot
+{
+public:
+    static constexpr uint64_t kBatchCalls = 16;
+    static constexpr uint64_t kExploreBatches = 40;
+    static constexpr uint64_t kReviewCalls = 200000;
+
+    struct Candidate
+    {
+        std::string szName;
+        std::unique_ptr<Behavior> behavior;
+        uint64_t nCalls = 0;
+        uint64_t nBatches = 0;
+        double dTotalNs = 0.0;
+        double MeanNs() const { return nCalls ? dTotalNs / nCalls : 0.0; }
+    };
+
+    struct Decision
+    {
+        uint64_t nAtCall = 0; // calls made through the slot when the decision was taken
+        std::string szChosen;
+        std::string szReason;
+    };
+
+    void Add(std::string szName, std::unique_ptr<Behavior> behavior)
+    {
+        m_vCandidates.push_back(Candidate{std::move(szName), std::move(behavior)});
+        StartExploring();
+    }
+
+    /* Calls fn(Behavior &) on the current choice. fn may return void. */
+    template <typename Fn>
+    auto Invoke(Fn &&fn)
+    {
+        if (--m_nUntilReview != 0)
+            return fn(*m_pChosen);
+        return InvokeSlow(std::forward<Fn>(fn));
+    }
+
+    bool Committed() const { return m_bCommitted; }
+    const std::vector<Decision> &Report() const { return m_vDecisions; }
+    const std::vector<Candidate> &Candidates() const { return m_vCandidates; }
+
+private:
+    void StartExploring()
+    {
+        for (auto &candidate : m_vCandidates)
+        {
+            candidate.nCalls = 0;
+            candidate.nBatches = 0;
+            candidate.dTotalNs = 0.0;
+        }
+        m_bCommitted = false;
+        m_nExplored = 0;
+        m_pExploring = nullptr;
+        m_pChosen = m_vCandidates.front().behavior.get();
+        m_nUntilReview = 1; // route the next call through InvokeSlow
+    }
+
+    /*
+     * UCB1 on cost: the lowest mean minus its uncertainty; untried candidates go first. The uncertainty is scaled by
+     * the largest mean, so that costs play the part of UCB1's rewards in [0, 1]. Subtracting it rather than scaling
+     * the mean by it keeps the order right while a factor like 1 - sqrt(2 ln n / calls) would still be negative.
+     */
+    Candidate &PickCandidate()
+    {
+        double dScale = 0.0;
+        for (auto &candidate : m_vCandidates)
+        {
+            if (candidate.nCalls == 0)
+                return candidate;
+            dScale = std::max(dScale, candidate.MeanNs());
+        }
+
+        Candidate *pBest = nullptr;
+        double dBestBound = std::numeric_limits<double>::infinity();
+        for (auto &candidate : m_vCandidates)
+        {
+            double dBound = candidate.MeanNs() - dScale * std::sqrt(2.0 * std::log(double(m_nExplored)) / candidate.nBatches);
+            if (dBound < dBestBound)
+            {
+                dBestBound = dBound;
+                pBest = &candidate;
+            }
+        }
+        return *pBest;
+    }
+
+    void Commit()
+    {
+        const Candidate *pBest = &m_vCandidates.front();
+        for (const auto &candidate : m_vCandidates)
+            if (candidate.MeanNs() < pBest->MeanNs())
+                pBest = &candidate;
+
+        std::ostringstream reason;
+        reason << pBest->szName << " " << pBest->MeanNs() << " ns/call";
+        for (const auto &candidate : m_vCandidates)
+            if (&candidate != pBest)
+                reason << ", " << candidate.szName << " " << candidate.MeanNs() << " ns/call (" << candidate.nCalls
+                       << " calls)";
+        m_vDecisions.push_back(Decision{m_nTotalCalls, pBest->szName, reason.str()});
+
+        m_pChosen = pBest->behavior.get();
+        m_bCommitted = true;
+        m_nUntilReview = kReviewCalls;
+    }
+
+    /*
+     * Runs at the first call of every batch. The batch that just ended is charged with the time since it started,
+     * then the next batch begins with this call. The call comes last, after all bookkeeping, so fn may return void.
+     */
+    template <typename Fn>
+    auto InvokeSlow(Fn &&fn)
+    {
+        if (m_vCandidates.empty())
+            std::terminate(); // Invoke before any Add: there is nothing to call
+        auto now = std::chrono::steady_clock::now();
+        if (m_bCommitted)
+        {
+            m_nTotalCalls += kReviewCalls;
+            StartExploring();
+        }
+        else if (m_pExploring)
+        {
+            m_pExploring->dTotalNs += std::chrono::duration<double, std::nano>(now - m_BatchStart).count();
+            m_pExploring->nCalls += kBatchCalls;
+            ++m_pExploring->nBatches;
+            m_nTotalCalls += kBatchCalls;
+            ++m_nExplored;
+        }
+
+        if (m_nExplored == kExploreBatches)
+            Commit();
+        else
+        {
+            m_pExploring = &PickCandidate();
+            m_pChosen = m_pExploring->behavior.get();
+            m_nUntilReview = kBatchCalls;
+            m_BatchStart = now;
+        }
+        return fn(*m_pChosen);
+    }
+
+    std::vector<Candidate> m_vCandidates;
+    Behavior *m_pChosen = nullptr;
+    Candidate *m_pExploring = nullptr; // candidate timed by the current batch
+    std::chrono::steady_clock::time_point m_BatchStart;
+    uint64_t m_nUntilReview = 1;
+    uint64_t m_nExplored = 0; // batches timed since exploring started
+    uint64_t m_nTotalCalls = 0; // committed calls are added in bulk at each review
+    bool m_bCommitted = false;
+    std::vector<Decision> m_vDecisions;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+class IDuck
+{
+public:
+    virtual ~IDuck() = default;
+
+    virtual std::string Display() = 0;
+    float PerformFly(const std::vector<Waypoint> &vRoute)
+    {
+        return m_FlyBehavior.Invoke([&](IFlyBehavior &behavior)
+                                    { return behavior.Fly(vRoute); });
+    }
+    const AdaptiveSlot<IFlyBehavior> &FlyBehavior() const { return m_FlyBehavior; }
+
+protected:
+    AdaptiveSlot<IFlyBehavior> m_FlyBehavior;
+};
+
+class MigratingDuck : public IDuck
+{
+public:
+    MigratingDuck()
+    {
+        m_FlyBehavior.Add("FlyStraight", std::make_unique<FlyStraight>());
+        m_FlyBehavior.Add("FlyInFormation", std::make_unique<FlyInFormation>());
+        m_FlyBehavior.Add("FlyCarefully", std::make_unique<FlyCarefully>());
+    }
+
+    std::string Display() override { return "I'm Migrating Duck !!! \n"; }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    auto makeRoute = [](size_t nPoints)
+    {
+        std::vector<Waypoint> vRoute(nPoints);
+        for (size_t i = 0; i < nPoints; ++i)
+            vRoute[i] = Waypoint{float(i % 97) * 0.5f, float(i % 89) * 0.25f};
+        return vRoute;
+    };
+
+    MigratingDuck duck;
+    std::cout << duck.Display();
+
+    /* Short hops first, then long migrations: the review after the switch re-evaluates on the new workload. */
+    const std::vector<Waypoint> vShort = makeRoute(16), vLong = makeRoute(4096);
+    double dDistance = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int call = 0; call < 400000; ++call)
+        dDistance += duck.PerformFly(vShort);
+    for (int call = 0; call < 250000; ++call)
+        dDistance += duck.PerformFly(vLong);
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Flew " << dDistance << " units in " << dSeconds << " s\n";
+    for (const auto &decision : duck.FlyBehavior().Report())
+        std::cout << "After " << decision.nAtCall << " calls chose " << decision.szChosen << ": " << decision.szReason
+                  << "\n";
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+The Strategy Pattern with behaviors that can be swapped while other threads use them.
+IDuck::SetFlyBehavior assigns a new std::unique_ptr, which deletes the old behavior while a thread inside PerformFly
+may still be calling it. Here each behavior sits in a StrategySlot:
+ - readers pin the current epoch and load the behavior with one atomic load, they never lock;
+ - writers publish a new behavior with an atomic exchange and retire the old one;
+ - a retired behavior is deleted once every reader that could have loaded it has left its epoch.
+Behaviors return their message instead of printing it so the benchmark measures the slot, not std::cout.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../../../common/epoch_manager.h"
+
+/* Owns one behavior. Get() is only valid while the caller holds an EpochManager::Guard. */
+template <typename Behavior>
+class StrategySlot
+{
+public:
+    StrategySlot(EpochManager &epochs, std::unique_ptr<Behavior> behavior)
+        : m_Epochs(epochs), m_pCurrent(behavior.release()) {}
+
+    ~StrategySlot() { delete m_pCurrent.load(); }
+
+    StrategySlot(const StrategySlot &) = delete;
+    StrategySlot &operator=(const StrategySlot &) = delete;
+
+    Behavior *Get() const { return m_pCurrent.load(std::memory_order_acquire); }
+
+    void Publish(std::unique_ptr<Behavior> behavior)
+    {
+        Behavior *pOld = m_pCurrent.exchange(behavior.release(), std::memory_order_seq_cst);
+        m_Epochs.Retire([pOld]
+                        { delete pOld; });
+    }
+
+private:
+    EpochManager &m_Epochs;
+    std::atomic<Behavior *> m_pCurrent;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Family of Quack Behaviors */
+class IQuackBehavior
+{
+public:
+    virtual ~IQuackBehavior() = default;
+    virtual std::string_view Quack() = 0;
+};
+
+class SimpleQuack : public IQuackBehavior
+{
+public:
+    std::string_view Quack() override { return "Simple Quack !!! \n"; }
+};
+
+class MuteQuack : public IQuackBehavior
+{
+public:
+    std::string_view Quack() override { return "Mute Quack !!! \n"; }
+};
+
+class SqueakQuack : public IQuackBehavior
+{
+public:
+    std::string_view Quack() override { return "Squeak Quack !!! \n"; }
+};
+
+/* Family of Fly Behaviors */
+class IFlyBehavior
+{
+public:
+    virtual ~IFlyBehavior() = default;
+    virtual std::string_view Fly() = 0;
+};
+
+class FlyWithWings : public IFlyBehavior
+{
+public:
+    std::string_view Fly() override { return "Fly with Wings !!! \n"; }
+};
+
+class FlyNoWay : public IFlyBehavior
+{
+public:
+    std::string_view Fly() override { return "Fly No Way !!! \n"; }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+class IDuck
+{
+public:
+    IDuck(EpochManager &epochs, std::unique_ptr<IFlyBehavior> flyBehavior, std::unique_ptr<IQuackBehavior> quackBehavior)
+        : m_Epochs(epochs), m_FlyBehavior(epochs, std::move(flyBehavior)), m_QuackBehavior(epochs, std::move(quackBehavior)) {}
+    virtual ~IDuck() = default;
+
+    virtual std::string_view Display() = 0;
+    /* Safe to call from any number of threads, concurrently with the setters. */
+    std::string_view PerformQuack()
+    {
+        auto guard = m_Epochs.Pin();
+        return m_QuackBehavior.Get()->Quack();
+    }
+    std::string_view PerformFly()
+    {
+        auto guard = m_Epochs.Pin();
+        return m_FlyBehavior.Get()->Fly();
+    }
+    void SetFlyBehavior(std::unique_ptr<IFlyBehavior> flyBehavior) { m_FlyBehavior.Publish(std::move(flyBehavior)); }
+    void SetQuackBehavior(std::unique_ptr<IQuackBehavior> quackBehavior) { m_QuackBehavior.Publish(std::move(quackBehavior)); }
+
+private:
+    EpochManager &m_Epochs;
+    StrategySlot<IFlyBehavior> m_FlyBehavior;
+    StrategySlot<IQuackBehavior> m_QuackBehavior;
+};
+
+class MallardDuck : public IDuck
+{
+public:
+    explicit MallardDuck(EpochManager &epochs)
+        : IDuck(epochs, std::make_unique<FlyNoWay>(), std::make_unique<SimpleQuack>()) {}
+
+    std::string_view Display() override { return "I'm Mallard Duck !!! \n"; }
+};
+
+class ModelDuck : public IDuck
+{
+public:
+    explicit ModelDuck(EpochManager &epochs)
+        : IDuck(epochs, std::make_unique<FlyWithWings>(), std::make_unique<MuteQuack>()) {}
+
+    std::string_view Display() override { return "I'm Model Duck !! \n"; }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Baseline: the same slot guarded by a mutex, so readers serialise with each other and with the writer. */
+class LockedDuck
+{
+public:
+    std::string_view PerformFly()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_FlyBehavior->Fly();
+    }
+    void SetFlyBehavior(std::unique_ptr<IFlyBehavior> flyBehavior)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FlyBehavior = std::move(flyBehavior);
+    }
+
+private:
+    std::mutex m_Mutex;
+    std::unique_ptr<IFlyBehavior> m_FlyBehavior = std::make_unique<FlyWithWings>();
+};
+
+/* Many readers call PerformFly for a fixed time while one writer swaps the behavior every millisecond. */
+template <typename Duck>
+double ReadsPerSecond(Duck &duck, unsigned nReaders, uint64_t &nSwaps)
+{
+    std::atomic<bool> bRunning{true};
+    std::atomic<uint64_t> nReads{0};
+    std::vector<std::thread> vReaders;
+    for (unsigned t = 0; t < nReaders; ++t)
+    {
+        vReaders.emplace_back([&]
+                              {
+            uint64_t nLocal = 0, nLength = 0;
+            while (bRunning.load(std::memory_order_relaxed))
+            {
+                nLength += duck.PerformFly().size();
+                ++nLocal;
+            }
+            nReads += nLocal + (nLength == 0); });
+    }
+
+    nSwaps = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto stop = start + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < stop)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (nSwaps++ % 2 == 0)
+            duck.SetFlyBehavior(std::make_unique<FlyNoWay>());
+        else
+            duck.SetFlyBehavior(std::make_unique<FlyWithWings>());
+    }
+    bRunning = false;
+    for (auto &reader : vReaders)
+        reader.join();
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return nReads / dSeconds;
+}
+
+int main()
+{
+    EpochManager epochs;
+
+    ModelDuck model(epochs);
+    std::cout << model.Display() << model.PerformFly() << model.PerformQuack() << "\n";
+    model.SetFlyBehavior(std::make_unique<FlyNoWay>());
+    model.SetQuackBehavior(std::make_unique<SqueakQuack>());
+    std::cout << model.Display() << model.PerformFly() << model.PerformQuack() << "\n";
+
+    unsigned nReaders = std::max(2u, std::thread::hardware_concurrency());
+    uint64_t nLockedSwaps = 0, nEpochSwaps = 0;
+    LockedDuck locked;
+    double dLocked = ReadsPerSecond(locked, nReaders, nLockedSwaps);
+    MallardDuck mallard(epochs);
+    double dEpoch = ReadsPerSecond(mallard, nReaders, nEpochSwaps);
+    epochs.Collect();
+
+    std::cout << "=== " << nReaders << " readers, one writer swapping every millisecond ===\n";
+    std::cout << "Mutex slot       : " << dLocked / 1e6 << " M PerformFly/s, " << nLockedSwaps << " swaps\n";
+    std::cout << "Epoch slot       : " << dEpoch / 1e6 << " M PerformFly/s, " << nEpochSwaps << " swaps\n";
+    std::cout << "Behaviors pending reclamation: " << epochs.PendingCount() << "\n";
+    return 0;
+}
@@ -0,0 +1,331 @@
+/*
+The Strategy Pattern without virtual dispatch.
+IDuck::PerformQuack / PerformFly go through a std::unique_ptr to a behavior and make a virtual call on it.
+Here the same family of behaviors is plugged into a duck in two other ways:
+ - VariantDispatch::Duck keeps its behaviors in a std::variant and dispatches with std::visit. The set of behaviors is
+   closed, but they can still be swapped at runtime and are stored inline, without a heap allocation.
+ - PolicyDispatch::Duck<Fly, Quack> takes its behaviors as template parameters. Calls are resolved at compile time and
+   inline completely; swapping to another behavior type produces a new duck type (WithFlyBehavior).
+Behaviors return their message instead of printing it so the dispatch cost itself can be benchmarked.
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+/* Family of Quack Behaviors */
+namespace Behaviors
+{
+    struct SimpleQuack
+    {
+        std::string_view Quack() const { return "Simple Quack !!! \n"; }
+    };
+
+    struct MuteQuack
+    {
+        std::string_view Quack() const { return "Mute Quack !!! \n"; }
+    };
+
+    struct SqueakQuack
+    {
+        std::string_view Quack() const { return "Squeak Quack !!! \n"; }
+    };
+
+    /* Family of Fly Behaviors */
+    struct FlyWithWings
+    {
+        std::string_view Fly() const { return "Fly with Wings !!! \n"; }
+    };
+
+    struct FlyNoWay
+    {
+        std::string_view Fly() const { return "Fly No Way !!! \n"; }
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Classic form, as in strategy_pattern.cpp: behaviors behind std::unique_ptr and virtual calls */
+namespace VirtualDispatch
+{
+    class IQuackBehavior
+    {
+    public:
+        virtual ~IQuackBehavior() = default;
+        virtual std::string_view Quack() = 0;
+    };
+
+    class IFlyBehavior
+    {
+    public:
+        virtual ~IFlyBehavior() = default;
+        virtual std::string_view Fly() = 0;
+    };
+
+    template <typename Behavior>
+    class QuackBehavior : public IQuackBehavior
+    {
+    public:
+        std::string_view Quack() override { return m_Behavior.Quack(); }
+
+    private:
+        Behavior m_Behavior;
+    };
+
+    template <typename Behavior>
+    class FlyBehavior : public IFlyBehavior
+    {
+    public:
+        std::string_view Fly() override { return m_Behavior.Fly(); }
+
+    private:
+        Behavior m_Behavior;
+    };
+
+    class IDuck
+    {
+    public:
+        virtual ~IDuck() = default;
+        virtual std::string_view PerformQuack() { return m_QuackBehavior->Quack(); }
+        virtual std::string_view PerformFly() { return m_FlyBehavior->Fly(); }
+        virtual void SetFlyBehavior(std::unique_ptr<IFlyBehavior> flyBehavior) { m_FlyBehavior = std::move(flyBehavior); }
+        virtual void SetQuackBehavior(std::unique_ptr<IQuackBehavior> quackBehavior) { m_QuackBehavior = std::move(quackBehavior); }
+
+    protected:
+        std::unique_ptr<IFlyBehavior> m_FlyBehavior;
+        std::unique_ptr<IQuackBehavior> m_QuackBehavior;
+    };
+
+    class MallardDuck : public IDuck
+    {
+    public:
+        MallardDuck()
+        {
+            m_FlyBehavior = std::make_unique<FlyBehavior<Behaviors::FlyNoWay>>();
+            m_QuackBehavior = std::make_unique<QuackBehavior<Behaviors::SimpleQuack>>();
+        }
+    };
+
+    class ModelDuck : public IDuck
+    {
+    public:
+        ModelDuck()
+        {
+            m_FlyBehavior = std::make_unique<FlyBehavior<Behaviors::FlyWithWings>>();
+            m_QuackBehavior = std::make_unique<QuackBehavior<Behaviors::MuteQuack>>();
+        }
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Closed set of behaviors held inline in a std::variant */
+namespace VariantDispatch
+{
+    using QuackBehavior = std::variant<Behaviors::SimpleQuack, Behaviors::MuteQuack, Behaviors::SqueakQuack>;
+    using FlyBehavior = std::variant<Behaviors::FlyWithWings, Behaviors::FlyNoWay>;
+
+    class Duck
+    {
+    public:
+        Duck(FlyBehavior flyBehavior, QuackBehavior quackBehavior)
+            : m_FlyBehavior(flyBehavior), m_QuackBehavior(quackBehavior) {}
+
+        std::string_view PerformQuack() const
+        {
+            return std::visit([](const auto &behavior)
+                              { return behavior.Quack(); },
+                              m_QuackBehavior);
+        }
+        std::string_view PerformFly() const
+        {
+            return std::visit([](const auto &behavior)
+                              { return behavior.Fly(); },
+                              m_FlyBehavior);
+        }
+        void SetFlyBehavior(FlyBehavior flyBehavior) { m_FlyBehavior = flyBehavior; }
+        void SetQuackBehavior(QuackBehavior quackBehavior) { m_QuackBehavior = quackBehavior; }
+
+    private:
+        FlyBehavior m_FlyBehavior;
+        QuackBehavior m_QuackBehavior;
+    };
+
+    inline Duck MallardDuck() { return Duck(Behaviors::FlyNoWay{}, Behaviors::SimpleQuack{}); }
+    inline Duck ModelDuck() { return Duck(Behaviors::FlyWithWings{}, Behaviors::MuteQuack{}); }
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Behaviors chosen at compile time */
+namespace PolicyDispatch
+{
+    template <typename FlyPolicy, typename QuackPolicy>
+    class Duck
+    {
+    public:
+        Duck() = default;
+        Duck(FlyPolicy flyBehavior, QuackPolicy quackBehavior)
+            : m_FlyBehavior(flyBehavior), m_QuackBehavior(quackBehavior) {}
+
+        std::string_view PerformQuack() const { return m_QuackBehavior.Quack(); }
+        std::string_view PerformFly() const { return m_FlyBehavior.Fly(); }
+
+        /* Same behavior type, new state */
+        void SetFlyBehavior(FlyPolicy flyBehavior) { m_FlyBehavior = flyBehavior; }
+        void SetQuackBehavior(QuackPolicy quackBehavior) { m_QuackBehavior = quackBehavior; }
+
+        /* A different behavior type is a different duck type */
+        template <typename NewFly>
+        Duck<NewFly, QuackPolicy> WithFlyBehavior(NewFly flyBehavior = {}) const { return {flyBehavior, m_QuackBehavior}; }
+        template <typename NewQuack>
+        Duck<FlyPolicy, NewQuack> WithQuackBehavior(NewQuack quackBehavior = {}) const { return {m_FlyBehavior, quackBehavior}; }
+
+    private:
+        FlyPolicy m_FlyBehavior;
+        QuackPolicy m_QuackBehavior;
+    };
+
+    using MallardDuck = Duck<Behaviors::FlyNoWay, Behaviors::SimpleQuack>;
+    using ModelDuck = Duck<Behaviors::FlyWithWings, Behaviors::MuteQuack>;
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+namespace Benchmark
+{
+    constexpr int kCalls = 50000000;
+    constexpr int kFlock = 4096;
+
+    /* Sums message lengths so the calls cannot be optimised away. */
+    template <typename Body>
+    void Run(const char *szLabel, int nCalls, Body &&body)
+    {
+        auto start = std::chrono::steady_clock::now();
+        size_t nChecksum = body();
+        double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << szLabel << dSeconds * 1e9 / nCalls << " ns per PerformFly + PerformQuack (checksum " << nChecksum << ")\n";
+    }
+
+    /* Makes the compiler treat value as read and changed here, so a loop whose result it could work out at compile
+       time still runs once per iteration. */
+    template <typename T>
+    inline void DoNotOptimize(T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : "+r"(value) : : "memory");
+#else
+        volatile T copy = value;
+        value = copy;
+#endif
+    }
+
+    /* Pseudo random behavior per duck so that the branch predictor cannot learn the sequence. */
+    inline uint32_t Behavior(int nDuck, uint32_t nChoices)
+    {
+        return static_cast<uint32_t>((uint64_t(nDuck) * 0x9e3779b97f4a7c15ull) >> 40) % nChoices;
+    }
+}
+
+int main(int argc, char **)
+{
+    /* Same output as strategy_pattern.cpp, with each form */
+    VirtualDispatch::MallardDuck virtualMallard;
+    std::cout << virtualMallard.PerformFly() << virtualMallard.PerformQuack() << "\n";
+
+    VariantDispatch::Duck variantModel = VariantDispatch::ModelDuck();
+    std::cout << variantModel.PerformFly() << variantModel.PerformQuack();
+    variantModel.SetFlyBehavior(Behaviors::FlyNoWay{});
+    variantModel.SetQuackBehavior(Behaviors::SqueakQuack{});
+    std::cout << variantModel.PerformFly() << variantModel.PerformQuack() << "\n";
+
+    PolicyDispatch::ModelDuck policyModel;
+    auto policyModified = policyModel.WithFlyBehavior<Behaviors::FlyNoWay>().WithQuackBehavior<Behaviors::SqueakQuack>();
+    std::cout << policyModel.PerformFly() << policyModel.PerformQuack();
+    std::cout << policyModified.PerformFly() << policyModified.PerformQuack() << "\n";
+
+    /* One duck called in a hot loop. The virtual duck's type depends on argc so it cannot be devirtualised, and every
+       loop passes its sum through DoNotOptimize so that none of them is folded into a constant. */
+    std::cout << "=== One duck, " << Benchmark::kCalls << " rounds ===\n";
+    std::unique_ptr<VirtualDispatch::IDuck> hotVirtual;
+    if (argc > 5)
+        hotVirtual = std::make_unique<VirtualDispatch::MallardDuck>();
+    else
+        hotVirtual = std::make_unique<VirtualDispatch::ModelDuck>();
+    VariantDispatch::Duck hotVariant = argc > 5 ? VariantDispatch::MallardDuck() : VariantDispatch::ModelDuck();
+    PolicyDispatch::ModelDuck hotPolicy;
+
+    Benchmark::Run("virtual : ", Benchmark::kCalls, [&]
+                   {
+        size_t nSum = 0;
+        for (int i = 0; i < Benchmark::kCalls; ++i)
+        {
+            nSum += hotVirtual->PerformFly().size() + hotVirtual->PerformQuack().size();
+            Benchmark::DoNotOptimize(nSum);
+        }
+        return nSum; });
+    Benchmark::Run("variant : ", Benchmark::kCalls, [&]
+                   {
+        size_t nSum = 0;
+        for (int i = 0; i < Benchmark::kCalls; ++i)
+        {
+            nSum += hotVariant.PerformFly().size() + hotVariant.PerformQuack().size();
+            Benchmark::DoNotOptimize(nSum);
+        }
+        return nSum; });
+    Benchmark::Run("policy  : ", Benchmark::kCalls, [&]
+                   {
+        size_t nSum = 0;
+        for (int i = 0; i < Benchmark::kCalls; ++i)
+        {
+            nSum += hotPolicy.PerformFly().size() + hotPolicy.PerformQuack().size();
+            Benchmark::DoNotOptimize(nSum);
+        }
+        return nSum; });
+
+    /* A mixed flock: every duck has its own random behaviors. Policy ducks cannot mix types in one array. */
+    std::cout << "=== Mixed flock of " << Benchmark::kFlock << " ducks ===\n";
+    std::vector<std::unique_ptr<VirtualDispatch::IDuck>> vVirtualFlock;
+    std::vector<VariantDispatch::Duck> vVariantFlock;
+    for (int duck = 0; duck < Benchmark::kFlock; ++duck)
+    {
+        uint32_t nFly = Benchmark::Behavior(duck, 2), nQuack = Benchmark::Behavior(duck * 7 + 3, 3);
+        auto virtualDuck = std::make_unique<VirtualDispatch::MallardDuck>();
+        VariantDispatch::Duck variantDuck = VariantDispatch::MallardDuck();
+        if (nFly == 1)
+        {
+            virtualDuck->SetFlyBehavior(std::make_unique<VirtualDispatch::FlyBehavior<Behaviors::FlyWithWings>>());
+            variantDuck.SetFlyBehavior(Behaviors::FlyWithWings{});
+        }
+        if (nQuack == 1)
+        {
+            virtualDuck->SetQuackBehavior(std::make_unique<VirtualDispatch::QuackBehavior<Behaviors::MuteQuack>>());
+            variantDuck.SetQuackBehavior(Behaviors::MuteQuack{});
+        }
+        else if (nQuack == 2)
+        {
+            virtualDuck->SetQuackBehavior(std::make_unique<VirtualDispatch::QuackBehavior<Behaviors::SqueakQuack>>());
+            variantDuck.SetQuackBehavior(Behaviors::SqueakQuack{});
+        }
+        vVirtualFlock.push_back(std::move(virtualDuck));
+        vVariantFlock.push_back(variantDuck);
+    }
+
+    const int nRounds = Benchmark::kCalls / Benchmark::kFlock;
+    Benchmark::Run("virtual : ", nRounds * Benchmark::kFlock, [&]
+                   {
+        size_t nSum = 0;
+        for (int round = 0; round < nRounds; ++round)
+            for (const auto &duck : vVirtualFlock)
+                nSum += duck->PerformFly().size() + duck->PerformQuack().size();
+        return nSum; });
+    Benchmark::Run("variant : ", nRounds * Benchmark::kFlock, [&]
+                   {
+        size_t nSum = 0;
+        for (int round = 0; round < nRounds; ++round)
+            for (const auto &duck : vVariantFlock)
+                nSum += duck.PerformFly().size() + duck.PerformQuack().size();
+        return nSum; });
+
+    return 0;
+}
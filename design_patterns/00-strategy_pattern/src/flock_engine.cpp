@@ -0,0 +1,466 @@
+/*
+Data oriented flock of ducks.
+With the classic Strategy Pattern every duck is a heap object that owns two heap allocated behaviors, and every
+Fly/Quack is a virtual call on a pointer chased from a pointer. For millions of ducks this is slow: the calls
+cannot be predicted and every duck is a cache miss.
+
+The Flock keeps duck state in contiguous arrays, grouped by (fly behavior, quack behavior). Each behavior is a
+kernel that runs once over its whole group, so there is no per duck dispatch, and groups are split across cores.
+Behaviors still have a kind, so the usual IFlyBehavior / IQuackBehavior objects map onto the kernels and a duck
+can change behavior at runtime (it moves to another group).
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* State a behavior acts on */
+struct DuckState
+{
+    float fAltitude = 0.0f;
+    float fEnergy = 100.0f;
+    uint32_t nQuacks = 0;
+};
+
+enum class FlyKind : uint8_t
+{
+    WithWings,
+    NoWay,
+    Count
+};
+
+enum class QuackKind : uint8_t
+{
+    Simple,
+    Mute,
+    Squeak,
+    Count
+};
+
+/* The effect of every behavior, shared by the per duck objects and the flock kernels */
+namespace Effects
+{
+    inline void FlyWithWings(float &fAltitude, float &fEnergy)
+    {
+        fAltitude = std::min(fAltitude + 1.5f, 120.0f);
+        fEnergy -= 0.25f;
+    }
+    inline void FlyNoWay(float &fAltitude) { fAltitude = 0.0f; }
+    inline void SimpleQuack(uint32_t &nQuacks, float &fEnergy)
+    {
+        nQuacks += 1;
+        fEnergy -= 0.05f;
+    }
+    inline void SqueakQuack(uint32_t &nQuacks, float &fEnergy)
+    {
+        nQuacks += 1;
+        fEnergy -= 0.02f;
+    }
+}
+
+/* Family of Quack Behaviors */
+class IQuackBehavior
+{
+public:
+    virtual ~IQuackBehavior() = default;
+    virtual void Quack(DuckState &duck) = 0;
+    virtual QuackKind Kind() const = 0;
+};
+
+class SimpleQuack : public IQuackBehavior
+{
+public:
+    void Quack(DuckState &duck) override { Effects::SimpleQuack(duck.nQuacks, duck.fEnergy); }
+    QuackKind Kind() const override { return QuackKind::Simple; }
+};
+
+class MuteQuack : public IQuackBehavior
+{
+public:
+    void Quack(DuckState &) override {}
+    QuackKind Kind() const override { return QuackKind::Mute; }
+};
+
+class SqueakQuack : public IQuackBehavior
+{
+public:
+    void Quack(DuckState &duck) override { Effects::SqueakQuack(duck.nQuacks, duck.fEnergy); }
+    QuackKind Kind() const override { return QuackKind::Squeak; }
+};
+
+/* Family of Fly Behaviors */
+class IFlyBehavior
+{
+public:
+    virtual ~IFlyBehavior() = default;
+    virtual void Fly(DuckState &duck) = 0;
+    virtual FlyKind Kind() const = 0;
+};
+
+class FlyWithWings : public IFlyBehavior
+{
+public:
+    void Fly(DuckState &duck) override { Effects::FlyWithWings(duck.fAltitude, duck.fEnergy); }
+    FlyKind Kind() const override { return FlyKind::WithWings; }
+};
+
+class FlyNoWay : public IFlyBehavior
+{
+public:
+    void Fly(DuckState &duck) override { Effects::FlyNoWay(duck.fAltitude); }
+    FlyKind Kind() const override { return FlyKind::NoWay; }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* One heap object per duck, as in strategy_pattern.cpp */
+class ObjectDuck
+{
+public:
+    ObjectDuck(std::unique_ptr<IFlyBehavior> flyBehavior, std::unique_ptr<IQuackBehavior> quackBehavior)
+        : m_FlyBehavior(std::move(flyBehavior)), m_QuackBehavior(std::move(quackBehavior)) {}
+
+    void PerformFly() { m_FlyBehavior->Fly(m_State); }
+    void PerformQuack() { m_QuackBehavior->Quack(m_State); }
+    const DuckState &State() const { return m_State; }
+
+private:
+    DuckState m_State;
+    std::unique_ptr<IFlyBehavior> m_FlyBehavior;
+    std::unique_ptr<IQuackBehavior> m_QuackBehavior;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Persistent workers; ParallelFor splits [0, n) into one contiguous slice per worker. */
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned nThreads) : m_nThreads(std::max(1u, nThreads))
+    {
+        for (unsigned t = 1; t < m_nThreads; ++t)
+            m_vWorkers.emplace_back([this, t]
+                                    { Run(t); });
+    }
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_bStopping = true;
+            ++m_nGeneration;
+        }
+        m_Start.notify_all();
+        for (auto &worker : m_vWorkers)
+            worker.join();
+    }
+
+    void ParallelFor(size_t n, const std::function<void(size_t, size_t)> &body)
+    {
+        if (m_nThreads == 1 || n < 4096)
+        {
+            body(0, n);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_pBody = &body;
+            m_nSize = n;
+            m_nPending = m_nThreads - 1;
+            ++m_nGeneration;
+        }
+        m_Start.notify_all();
+        body(0, n / m_nThreads);
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Done.wait(lock, [this]
+                    { return m_nPending == 0; });
+    }
+
+private:
+    void Run(unsigned nIndex)
+    {
+        uint64_t nSeen = 0;
+        while (true)
+        {
+            const std::function<void(size_t, size_t)> *pBody;
+            size_t nSize;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Start.wait(lock, [&]
+                             { return m_nGeneration != nSeen; });
+                nSeen = m_nGeneration;
+                if (m_bStopping)
+                    return;
+                pBody = m_pBody;
+                nSize = m_nSize;
+            }
+            (*pBody)(nSize * nIndex / m_nThreads, nSize * (nIndex + 1) / m_nThreads);
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                --m_nPending;
+            }
+            m_Done.notify_one();
+        }
+    }
+
+    unsigned m_nThreads;
+    std::vector<std::thread> m_vWorkers;
+    std::mutex m_Mutex;
+    std::condition_variable m_Start, m_Done;
+    const std::function<void(size_t, size_t)> *m_pBody = nullptr;
+    size_t m_nSize = 0;
+    unsigned m_nPending = 0;
+    uint64_t m_nGeneration = 0;
+    bool m_bStopping = false;
+};
+
+class Flock
+{
+public:
+    using DuckId = uint32_t;
+
+    explicit Flock(unsigned nThreads) : m_Pool(nThreads)
+    {
+        for (uint32_t nGroup = 0; nGroup < kGroups; ++nGroup)
+        {
+            m_aGroups[nGroup].eFly = FlyOf(nGroup);
+            m_aGroups[nGroup].eQuack = QuackOf(nGroup);
+        }
+    }
+
+    DuckId Add(const IFlyBehavior &flyBehavior, const IQuackBehavior &quackBehavior)
+    {
+        DuckId id = static_cast<DuckId>(m_vLocation.size());
+        m_vLocation.push_back(Location{});
+        Insert(id, GroupIndex(flyBehavior.Kind(), quackBehavior.Kind()), DuckState{});
+        return id;
+    }
+    DuckId AddMallard() { return Add(FlyNoWay{}, SimpleQuack{}); }
+    DuckId AddModel() { return Add(FlyWithWings{}, MuteQuack{}); }
+
+    /* Runtime behavior swap: the duck's state moves to the group of its new behavior pair. */
+    void SetFlyBehavior(DuckId id, const IFlyBehavior &flyBehavior)
+    {
+        Location location = m_vLocation[id];
+        Move(id, GroupIndex(flyBehavior.Kind(), QuackOf(location.nGroup)));
+    }
+    void SetQuackBehavior(DuckId id, const IQuackBehavior &quackBehavior)
+    {
+        Location location = m_vLocation[id];
+        Move(id, GroupIndex(FlyOf(location.nGroup), quackBehavior.Kind()));
+    }
+
+    DuckState State(DuckId id) const
+    {
+        const Location &location = m_vLocation[id];
+        const Group &group = m_aGroups[location.nGroup];
+        return DuckState{group.vAltitude[location.nSlot], group.vEnergy[location.nSlot], group.vQuacks[location.nSlot]};
+    }
+
+    size_t Size() const { return m_vLocation.size(); }
+
+    /* Every duck flies: one kernel per group, each group split across the workers. */
+    void PerformFly()
+    {
+        for (auto &group : m_aGroups)
+        {
+            float *pAltitude = group.vAltitude.data();
+            float *pEnergy = group.vEnergy.data();
+            switch (group.eFly)
+            {
+            case FlyKind::WithWings:
+                m_Pool.ParallelFor(group.vId.size(), [=](size_t nBegin, size_t nEnd)
+                                   {
+                    for (size_t i = nBegin; i < nEnd; ++i)
+                        Effects::FlyWithWings(pAltitude[i], pEnergy[i]); });
+                break;
+            case FlyKind::NoWay:
+                m_Pool.ParallelFor(group.vId.size(), [=](size_t nBegin, size_t nEnd)
+                                   {
+                    for (size_t i = nBegin; i < nEnd; ++i)
+                        Effects::FlyNoWay(pAltitude[i]); });
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    /* Every duck quacks; mute groups are skipped entirely. */
+    void PerformQuack()
+    {
+        for (auto &group : m_aGroups)
+        {
+            uint32_t *pQuacks = group.vQuacks.data();
+            float *pEnergy = group.vEnergy.data();
+            switch (group.eQuack)
+            {
+            case QuackKind::Simple:
+                m_Pool.ParallelFor(group.vId.size(), [=](size_t nBegin, size_t nEnd)
+                                   {
+                    for (size_t i = nBegin; i < nEnd; ++i)
+                        Effects::SimpleQuack(pQuacks[i], pEnergy[i]); });
+                break;
+            case QuackKind::Squeak:
+                m_Pool.ParallelFor(group.vId.size(), [=](size_t nBegin, size_t nEnd)
+                                   {
+                    for (size_t i = nBegin; i < nEnd; ++i)
+                        Effects::SqueakQuack(pQuacks[i], pEnergy[i]); });
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kFlyKinds = static_cast<size_t>(FlyKind::Count);
+    static constexpr size_t kQuackKinds = static_cast<size_t>(QuackKind::Count);
+    static constexpr size_t kGroups = kFlyKinds * kQuackKinds;
+
+    struct Group
+    {
+        FlyKind eFly = FlyKind::Count; // set for every group by the constructor, populated or not
+        QuackKind eQuack = QuackKind::Count;
+        std::vector<float> vAltitude;
+        std::vector<float> vEnergy;
+        std::vector<uint32_t> vQuacks;
+        std::vector<DuckId> vId; // slot -> duck, needed to patch locations on swap-remove
+    };
+
+    struct Location
+    {
+        uint32_t nGroup = 0;
+        uint32_t nSlot = 0;
+    };
+
+    static uint32_t GroupIndex(FlyKind eFly, QuackKind eQuack)
+    {
+        return static_cast<uint32_t>(static_cast<size_t>(eFly) * kQuackKinds + static_cast<size_t>(eQuack));
+    }
+    static FlyKind FlyOf(uint32_t nGroup) { return static_cast<FlyKind>(nGroup / kQuackKinds); }
+    static QuackKind QuackOf(uint32_t nGroup) { return static_cast<QuackKind>(nGroup % kQuackKinds); }
+
+    void Insert(DuckId id, uint32_t nGroup, const DuckState &state)
+    {
+        Group &group = m_aGroups[nGroup];
+        m_vLocation[id] = Location{nGroup, static_cast<uint32_t>(group.vId.size())};
+        group.vAltitude.push_back(state.fAltitude);
+        group.vEnergy.push_back(state.fEnergy);
+        group.vQuacks.push_back(state.nQuacks);
+        group.vId.push_back(id);
+    }
+
+    void Move(DuckId id, uint32_t nNewGroup)
+    {
+        Location location = m_vLocation[id];
+        if (location.nGroup == nNewGroup)
+            return;
+        DuckState state = State(id);
+
+        /* Swap-remove from the old group keeps every group dense. */
+        Group &group = m_aGroups[location.nGroup];
+        DuckId lastId = group.vId.back();
+        group.vAltitude[location.nSlot] = group.vAltitude.back();
+        group.vEnergy[location.nSlot] = group.vEnergy.back();
+        group.vQuacks[location.nSlot] = group.vQuacks.back();
+        group.vId[location.nSlot] = lastId;
+        m_vLocation[lastId].nSlot = location.nSlot;
+        group.vAltitude.pop_back();
+        group.vEnergy.pop_back();
+        group.vQuacks.pop_back();
+        group.vId.pop_back();
+
+        Insert(id, nNewGroup, state);
+    }
+
+    WorkerPool m_Pool;
+    Group m_aGroups[kGroups];
+    std::vector<Location> m_vLocation;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main(int argc, char **argv)
+{
+    const uint32_t nDucks = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 2000000u;
+    const int nTicks = 50;
+    unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    /* The same random population in both forms */
+    Flock flock(nThreads);
+    std::vector<std::unique_ptr<ObjectDuck>> vObjects;
+    for (uint32_t duck = 0; duck < nDucks; ++duck)
+    {
+        uint64_t nHash = (duck + 1) * 0x9e3779b97f4a7c15ull;
+        std::unique_ptr<IFlyBehavior> flyBehavior;
+        std::unique_ptr<IQuackBehavior> quackBehavior;
+        if ((nHash >> 40) % 2 == 0)
+            flyBehavior = std::make_unique<FlyWithWings>();
+        else
+            flyBehavior = std::make_unique<FlyNoWay>();
+        switch ((nHash >> 50) % 3)
+        {
+        case 0:
+            quackBehavior = std::make_unique<SimpleQuack>();
+            break;
+        case 1:
+            quackBehavior = std::make_unique<MuteQuack>();
+            break;
+        default:
+            quackBehavior = std::make_unique<SqueakQuack>();
+            break;
+        }
+        flock.Add(*flyBehavior, *quackBehavior);
+        vObjects.push_back(std::make_unique<ObjectDuck>(std::move(flyBehavior), std::move(quackBehavior)));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < nTicks; ++tick)
+    {
+        for (auto &duck : vObjects)
+        {
+            duck->PerformFly();
+            duck->PerformQuack();
+        }
+    }
+    double dObjectSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < nTicks; ++tick)
+    {
+        flock.PerformFly();
+        flock.PerformQuack();
+    }
+    double dFlockSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double dObjectSum = 0.0, dFlockSum = 0.0;
+    for (uint32_t duck = 0; duck < nDucks; ++duck)
+    {
+        const DuckState &object = vObjects[duck]->State();
+        DuckState grouped = flock.State(duck);
+        dObjectSum += object.fAltitude + object.fEnergy + object.nQuacks;
+        dFlockSum += grouped.fAltitude + grouped.fEnergy + grouped.nQuacks;
+    }
+
+    const double dUpdates = double(nDucks) * nTicks;
+    std::cout << "=== " << nDucks << " ducks, " << nTicks << " ticks of Fly + Quack on " << nThreads << " threads ===\n";
+    std::cout << "Object per duck : " << dObjectSeconds * 1e9 / dUpdates << " ns/duck\n";
+    std::cout << "Grouped flock   : " << dFlockSeconds * 1e9 / dUpdates << " ns/duck\n";
+    std::cout << "State checksums : " << dObjectSum << " vs " << dFlockSum << "\n";
+
+    /* A model duck learns to squeak and loses its wings. */
+    Flock::DuckId model = flock.AddModel();
+    flock.SetFlyBehavior(model, FlyNoWay{});
+    flock.SetQuackBehavior(model, SqueakQuack{});
+    flock.PerformFly();
+    flock.PerformQuack();
+    DuckState state = flock.State(model);
+    std::cout << "Model duck after swap: altitude " << state.fAltitude << ", quacks " << state.nQuacks << "\n";
+
+    return dObjectSum == dFlockSum ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+/*
+The Strategy Pattern with flyweight behaviors.
+In strategy_pattern.cpp every duck constructor allocates its two behaviors with std::make_unique, although FlyNoWay,
+SimpleQuack and friends hold no state at all. Here a duck keeps its behaviors in a BehaviorRef:
+ - a stateless behavior is a single shared instance from the Flyweights registry, referenced and never owned;
+ - a stateful behavior is constructed inside the BehaviorRef itself (small buffer storage) and owned by the duck.
+Either way creating a duck performs no heap allocation, which main checks with a counting operator new.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Counts every heap allocation in the process */
+static std::atomic<uint64_t> g_nAllocations{0};
+
+void *operator new(std::size_t nSize)
+{
+    g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pMemory = std::malloc(nSize ? nSize : 1))
+        return pMemory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pMemory) noexcept { std::free(pMemory); }
+void operator delete(void *pMemory, std::size_t) noexcept { std::free(pMemory); }
+
+/* A behavior either shared from the Flyweights registry or stored inline. Movable, not copyable. */
+template <typename Interface, std::size_t kInlineSize = 2 * sizeof(void *)>
+class BehaviorRef
+{
+public:
+    static BehaviorRef Shared(Interface &flyweight)
+    {
+        BehaviorRef ref;
+        ref.m_pBehavior = &flyweight;
+        return ref;
+    }
+
+    template <typename Behavior, typename... Args>
+    static BehaviorRef Inline(Args &&...args)
+    {
+        static_assert(std::is_base_of<Interface, Behavior>::value, "Behavior must implement Interface");
+        static_assert(sizeof(Behavior) <= kInlineSize && alignof(Behavior) <= alignof(std::max_align_t),
+                      "Behavior does not fit the inline buffer");
+        static_assert(std::is_nothrow_move_constructible<Behavior>::value, "Behavior must be nothrow movable");
+        BehaviorRef ref;
+        ref.m_pBehavior = new (ref.m_Storage) Behavior(std::forward<Args>(args)...);
+        ref.m_pManage = &Manage<Behavior>;
+        return ref;
+    }
+
+    BehaviorRef(BehaviorRef &&other) noexcept { MoveFrom(other); }
+    BehaviorRef &operator=(BehaviorRef &&other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            MoveFrom(other);
+        }
+        return *this;
+    }
+    BehaviorRef(const BehaviorRef &) = delete;
+    BehaviorRef &operator=(const BehaviorRef &) = delete;
+    ~BehaviorRef() { Reset(); }
+
+    Interface *operator->() const { return m_pBehavior; }
+
+private:
+    enum class Operation
+    {
+        Move,
+        Destroy
+    };
+
+    BehaviorRef() = default;
+
+    /* Moves the inline behavior from pFrom into pTo, or destroys pFrom's behavior. */
+    template <typename Behavior>
+    static void Manage(Operation eOperation, BehaviorRef *pFrom, BehaviorRef *pTo)
+    {
+        Behavior *pBehavior = std::launder(reinterpret_cast<Behavior *>(pFrom->m_Storage));
+        if (eOperation == Operation::Move)
+            pTo->m_pBehavior = new (pTo->m_Storage) Behavior(std::move(*pBehavior));
+        pBehavior->~Behavior();
+    }
+
+    void MoveFrom(BehaviorRef &other)
+    {
+        m_pManage = other.m_pManage;
+        if (m_pManage)
+            m_pManage(Operation::Move, &other, this);
+        else
+            m_pBehavior = other.m_pBehavior;
+        other.m_pManage = nullptr;
+        other.m_pBehavior = nullptr;
+    }
+
+    void Reset()
+    {
+        if (m_pManage)
+            m_pManage(Operation::Destroy, this, nullptr);
+        m_pManage = nullptr;
+        m_pBehavior = nullptr;
+    }
+
+    Interface *m_pBehavior = nullptr;
+    void (*m_pManage)(Operation, BehaviorRef *, BehaviorRef *) = nullptr; // null for shared behaviors
+    alignas(std::max_align_t) std::byte m_Storage[kInlineSize];
+};
+
+/* One instance per stateless behavior type, created on first use and shared by every duck. */
+class Flyweights
+{
+public:
+    template <typename Behavior>
+    static Behavior &Get()
+    {
+        static Behavior instance;
+        return instance;
+    }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Family of Quack Behaviors */
+class IQuackBehavior
+{
+public:
+    virtual ~IQuackBehavior() = default;
+    virtual std::string_view Quack() = 0;
+};
+
+class SimpleQuack : public IQuackBehavior
+{
+public:
+    std::string_view Quack() override { return "Simple Quack !!! \n"; }
+};
+
+class MuteQuack : public IQuackBehavior
+{
+public:
+    std::string_view Quack() override { return "Mute Quack !!! \n"; }
+};
+
+class SqueakQuack : public IQuackBehavior
+{
+public:
+    std::string_view Quack() override { return "Squeak Quack !!! \n"; }
+};
+
+/* Stateful: every duck gets its own count, so it is stored inline rather than shared. */
+class HoarseQuack : public IQuackBehavior
+{
+public:
+    explicit HoarseQuack(uint32_t nVoice) : m_nVoice(nVoice) {}
+    std::string_view Quack() override
+    {
+        if (m_nVoice == 0)
+            return "... \n";
+        --m_nVoice;
+        return "Hoarse Quack !!! \n";
+    }
+
+private:
+    uint32_t m_nVoice;
+};
+
+/* Family of Fly Behaviors */
+class IFlyBehavior
+{
+public:
+    virtual ~IFlyBehavior() = default;
+    virtual std::string_view Fly() = 0;
+};
+
+class FlyWithWings : public IFlyBehavior
+{
+public:
+    std::string_view Fly() override { return "Fly with Wings !!! \n"; }
+};
+
+class FlyNoWay : public IFlyBehavior
+{
+public:
+    std::string_view Fly() override { return "Fly No Way !!! \n"; }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+class IDuck
+{
+public:
+    using FlyRef = BehaviorRef<IFlyBehavior>;
+    using QuackRef = BehaviorRef<IQuackBehavior>;
+
+    IDuck(FlyRef flyBehavior, QuackRef quackBehavior)
+        : m_FlyBehavior(std::move(flyBehavior)), m_QuackBehavior(std::move(quackBehavior)) {}
+    virtual ~IDuck() = default;
+    IDuck(IDuck &&) = default;
+
+    virtual std::string_view Display() = 0;
+    std::string_view PerformQuack() { return m_QuackBehavior->Quack(); }
+    std::string_view PerformFly() { return m_FlyBehavior->Fly(); }
+    void SetFlyBehavior(FlyRef flyBehavior) { m_FlyBehavior = std::move(flyBehavior); }
+    void SetQuackBehavior(QuackRef quackBehavior) { m_QuackBehavior = std::move(quackBehavior); }
+
+protected:
+    FlyRef m_FlyBehavior;
+    QuackRef m_QuackBehavior;
+};
+
+class MallardDuck : public IDuck
+{
+public:
+    MallardDuck()
+        : IDuck(FlyRef::Shared(Flyweights::Get<FlyNoWay>()), QuackRef::Shared(Flyweights::Get<SimpleQuack>())) {}
+
+    std::string_view Display() override { return "I'm Mallard Duck !!! \n"; }
+};
+
+class ModelDuck : public IDuck
+{
+public:
+    ModelDuck()
+        : IDuck(FlyRef::Shared(Flyweights::Get<FlyWithWings>()), QuackRef::Shared(Flyweights::Get<MuteQuack>())) {}
+
+    std::string_view Display() override { return "I'm Model Duck !! \n"; }
+};
+
+/* Classic form, as in strategy_pattern.cpp: every behavior is its own heap object */
+namespace Classic
+{
+    class IDuck
+    {
+    public:
+        virtual ~IDuck() = default;
+        std::string_view PerformFly() { return m_FlyBehavior->Fly(); }
+
+    protected:
+        std::unique_ptr<IFlyBehavior> m_FlyBehavior;
+        std::unique_ptr<IQuackBehavior> m_QuackBehavior;
+    };
+
+    class MallardDuck : public IDuck
+    {
+    public:
+        MallardDuck()
+        {
+            m_FlyBehavior = std::make_unique<FlyNoWay>();
+            m_QuackBehavior = std::make_unique<SimpleQuack>();
+        }
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    ModelDuck model;
+    std::cout << model.Display() << model.PerformFly() << model.PerformQuack() << "\n";
+    model.SetFlyBehavior(IDuck::FlyRef::Shared(Flyweights::Get<FlyNoWay>()));
+    model.SetQuackBehavior(IDuck::QuackRef::Inline<HoarseQuack>(1u));
+    std::cout << model.Display() << model.PerformFly() << model.PerformQuack() << model.PerformQuack() << "\n";
+
+    const size_t nDucks = 10000000;
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::unique_ptr<Classic::IDuck>> vClassic;
+    vClassic.reserve(nDucks);
+    uint64_t nBefore = g_nAllocations;
+    auto start = Clock::now();
+    for (size_t duck = 0; duck < nDucks; ++duck)
+        vClassic.push_back(std::make_unique<Classic::MallardDuck>());
+    double dClassicCreate = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t nClassicAllocations = g_nAllocations - nBefore;
+
+    std::vector<MallardDuck> vFlyweight;
+    vFlyweight.reserve(nDucks);
+    nBefore = g_nAllocations;
+    start = Clock::now();
+    for (size_t duck = 0; duck < nDucks; ++duck)
+        vFlyweight.emplace_back();
+    double dFlyweightCreate = std::chrono::duration<double>(Clock::now() - start).count();
+    uint64_t nFlyweightAllocations = g_nAllocations - nBefore;
+
+    size_t nClassicLength = 0, nFlyweightLength = 0;
+    start = Clock::now();
+    for (auto &duck : vClassic)
+        nClassicLength += duck->PerformFly().size();
+    double dClassicFly = std::chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+    for (auto &duck : vFlyweight)
+        nFlyweightLength += duck.PerformFly().size();
+    double dFlyweightFly = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "=== " << nDucks << " Mallard ducks ===\n";
+    std::cout << "Classic   : " << nClassicAllocations << " allocations, create " << dClassicCreate * 1e9 / nDucks
+              << " ns/duck, PerformFly " << dClassicFly * 1e9 / nDucks << " ns/duck\n";
+    std::cout << "Flyweight : " << nFlyweightAllocations << " allocations, create " << dFlyweightCreate * 1e9 / nDucks
+              << " ns/duck, PerformFly " << dFlyweightFly * 1e9 / nDucks << " ns/duck\n";
+    return nFlyweightAllocations == 0 && nClassicLength == nFlyweightLength ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+/*
+Pricing large batches of beverage orders.
+decorator_pattern.cpp prices one order at a time by recursing through its decorators, adding float prices as doubles.
+At tens of millions of orders that is slow, and 1.22f is not 1.22, so totals drift away from what the till says.
+
+The PricingEngine takes a columnar OrderBatch (one base id per order, all condiment ids in one flat array with an
+offset per order) and prices it in integer cents from a price table. Prices are looked up with AVX2 gathers when the
+build has them (-mavx2), otherwise with plain loads, and the batch is split across cores. Totals are exact, so the
+grand total reconciles with the one computed from item counts.
+*/
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* Price table in cents, ids as in decorator_pattern.cpp */
+namespace Menu
+{
+    enum Base : uint8_t
+    {
+        HouseBlend,
+        DarkRoast,
+        Espresso,
+        Decaf,
+        BaseCount
+    };
+
+    enum Condiment : uint8_t
+    {
+        Milk,
+        Mocha,
+        Soy,
+        Whip,
+        CondimentCount
+    };
+
+    constexpr std::array<int32_t, BaseCount> kBaseCents = {122, 150, 150, 140};
+    constexpr std::array<int32_t, CondimentCount> kCondimentCents = {60, 50, 40, 50};
+
+    /* The float prices the decorators use today, for comparison */
+    constexpr std::array<float, BaseCount> kBaseFloat = {1.22f, 1.5f, 1.5f, 1.4f};
+    constexpr std::array<float, CondimentCount> kCondimentFloat = {.6f, 0.5f, .4f, .5f};
+}
+
+/*
+ * Orders as columns: order i is Bases()[i] with condiments Condiments()[Offsets()[i] .. Offsets()[i + 1]).
+ * Add rejects ids outside the menu, so the pricing loops can index the price tables without checks.
+ */
+class OrderBatch
+{
+public:
+    size_t Size() const { return m_vBase.size(); }
+    const std::vector<uint8_t> &Bases() const { return m_vBase; }
+    const std::vector<uint32_t> &Offsets() const { return m_vOffset; }
+    const std::vector<uint8_t> &Condiments() const { return m_vCondiments; }
+
+    void Reserve(size_t nOrders, size_t nCondiments)
+    {
+        m_vBase.reserve(nOrders);
+        m_vOffset.reserve(nOrders + 1);
+        m_vCondiments.reserve(nCondiments);
+    }
+
+    void Add(uint8_t nBase, std::initializer_list<uint8_t> condiments) { Add(nBase, condiments.begin(), condiments.size()); }
+
+    void Add(uint8_t nBase, const uint8_t *pCondiments, size_t nCondiments)
+    {
+        if (nBase >= Menu::BaseCount)
+            throw std::invalid_argument("OrderBatch: unknown base id");
+        for (size_t i = 0; i < nCondiments; ++i)
+            if (pCondiments[i] >= Menu::CondimentCount)
+                throw std::invalid_argument("OrderBatch: unknown condiment id");
+        if (nCondiments > std::numeric_limits<uint32_t>::max() - m_vCondiments.size())
+            throw std::length_error("OrderBatch: too many condiments for 32-bit offsets");
+
+        m_vBase.push_back(nBase);
+        m_vCondiments.insert(m_vCondiments.end(), pCondiments, pCondiments + nCondiments);
+        m_vOffset.push_back(static_cast<uint32_t>(m_vCondiments.size()));
+    }
+
+private:
+    std::vector<uint8_t> m_vBase;
+    std::vector<uint32_t> m_vOffset{0};
+    std::vector<uint8_t> m_vCondiments;
+};
+
+class PricingEngine
+{
+public:
+    explicit PricingEngine(unsigned nThreads) : m_nThreads(std::max(1u, nThreads)) {}
+
+    /* Fills vTotal (cents per order) and returns the batch total in cents. */
+    int64_t Price(const OrderBatch &batch, std::vector<int64_t> &vTotal) const
+    {
+        const size_t nOrders = batch.Size();
+        vTotal.resize(nOrders);
+        std::vector<int64_t> vPartial(m_nThreads, 0);
+        std::vector<std::thread> vWorkers;
+        for (unsigned t = 0; t < m_nThreads; ++t)
+        {
+            vWorkers.emplace_back([&, t]
+                                  {
+                size_t nBegin = nOrders * t / m_nThreads, nEnd = nOrders * (t + 1) / m_nThreads;
+                vPartial[t] = PriceRange(batch, nBegin, nEnd, vTotal.data()); });
+        }
+        for (auto &worker : vWorkers)
+            worker.join();
+
+        int64_t nTotal = 0;
+        for (int64_t nPartial : vPartial)
+            nTotal += nPartial;
+        return nTotal;
+    }
+
+    /* Independent check: count every item sold and multiply by its price. */
+    static int64_t TotalFromCounts(const OrderBatch &batch)
+    {
+        std::array<int64_t, Menu::BaseCount> aBases{};
+        std::array<int64_t, Menu::CondimentCount> aCondiments{};
+        for (uint8_t nBase : batch.Bases())
+            ++aBases[nBase];
+        for (uint8_t nCondiment : batch.Condiments())
+            ++aCondiments[nCondiment];
+        int64_t nTotal = 0;
+        for (size_t i = 0; i < aBases.size(); ++i)
+            nTotal += aBases[i] * Menu::kBaseCents[i];
+        for (size_t i = 0; i < aCondiments.size(); ++i)
+            nTotal += aCondiments[i] * Menu::kCondimentCents[i];
+        return nTotal;
+    }
+
+private:
+    static constexpr size_t kBlock = 4096; // orders priced per pass, keeps the running sums in L1/L2
+
+    /* dst[i] = table[ids[i]] for i < n */
+    static void Gather(const int32_t *pTable, const uint8_t *pIds, size_t n, int32_t *pDst)
+    {
+        size_t i = 0;
+#if defined(__AVX2__)
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i ids = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(pIds + i)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(pDst + i), _mm256_i32gather_epi32(pTable, ids, 4));
+        }
+#endif
+        for (; i < n; ++i)
+            pDst[i] = pTable[pIds[i]];
+    }
+
+    static int64_t PriceRange(const OrderBatch &batch, size_t nBegin, size_t nEnd, int64_t *pTotal)
+    {
+        const std::vector<uint32_t> &vOffset = batch.Offsets();
+        std::vector<int32_t> vBaseCents, vCents;
+        std::vector<int64_t> vRunning;
+        int64_t nSum = 0;
+        for (size_t nBlock = nBegin; nBlock < nEnd; nBlock += kBlock)
+        {
+            const size_t nBlockEnd = std::min(nEnd, nBlock + kBlock);
+            const uint32_t nFirst = vOffset[nBlock], nLast = vOffset[nBlockEnd];
+
+            /* Prices are gathered as 32-bit cents; condiment prices are turned into 64-bit running sums, so each
+               order adds the difference of two running sums instead of looping over its condiments. */
+            vBaseCents.resize(nBlockEnd - nBlock);
+            Gather(Menu::kBaseCents.data(), batch.Bases().data() + nBlock, nBlockEnd - nBlock, vBaseCents.data());
+            vCents.resize(nLast - nFirst);
+            Gather(Menu::kCondimentCents.data(), batch.Condiments().data() + nFirst, nLast - nFirst, vCents.data());
+            vRunning.resize(vCents.size() + 1);
+            vRunning[0] = 0;
+            for (size_t i = 0; i < vCents.size(); ++i)
+                vRunning[i + 1] = vRunning[i] + vCents[i];
+
+            const int64_t *pRunning = vRunning.data() - nFirst;
+            for (size_t order = nBlock; order < nBlockEnd; ++order)
+            {
+                pTotal[order] = vBaseCents[order - nBlock] + pRunning[vOffset[order + 1]] - pRunning[vOffset[order]];
+                nSum += pTotal[order];
+            }
+        }
+        return nSum;
+    }
+
+    unsigned m_nThreads;
+};
+
+/* Today's way: per order, float prices added as doubles */
+double FloatTotal(const OrderBatch &batch)
+{
+    double dTotal = 0.0;
+    for (size_t order = 0; order < batch.Size(); ++order)
+    {
+        double dCost = Menu::kBaseFloat[batch.Bases()[order]];
+        for (uint32_t i = batch.Offsets()[order]; i < batch.Offsets()[order + 1]; ++i)
+            dCost += Menu::kCondimentFloat[batch.Condiments()[i]];
+        dTotal += dCost;
+    }
+    return dTotal;
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main(int argc, char **argv)
+{
+    const size_t nOrders = argc > 1 ? std::stoull(argv[1]) : 20000000;
+    unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    OrderBatch batch;
+    batch.Add(Menu::Espresso, {});
+    batch.Add(Menu::DarkRoast, {Menu::Mocha, Menu::Milk});
+    batch.Add(Menu::HouseBlend, {Menu::Mocha, Menu::Milk, Menu::Whip});
+
+    PricingEngine engine(nThreads);
+    std::vector<int64_t> vTotal;
+    engine.Price(batch, vTotal);
+    for (int64_t nCents : vTotal)
+        std::cout << "$" << nCents / 100 << "." << (nCents % 100 < 10 ? "0" : "") << nCents % 100 << "\n";
+
+    /* A large random batch with up to five condiments per order */
+    batch = OrderBatch{};
+    batch.Reserve(nOrders, nOrders * 5 / 2);
+    uint64_t nState = 0x9e3779b97f4a7c15ull;
+    auto next = [&]
+    {
+        nState ^= nState << 13;
+        nState ^= nState >> 7;
+        nState ^= nState << 17;
+        return nState;
+    };
+    for (size_t order = 0; order < nOrders; ++order)
+    {
+        uint64_t nRandom = next();
+        uint8_t aCondiments[5];
+        const size_t nCondiments = (nRandom >> 8) % 6;
+        for (size_t c = 0; c < nCondiments; ++c)
+            aCondiments[c] = static_cast<uint8_t>((nRandom >> (16 + 2 * c)) % Menu::CondimentCount);
+        batch.Add(static_cast<uint8_t>(nRandom % Menu::BaseCount), aCondiments, nCondiments);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t nCents = engine.Price(batch, vTotal);
+    double dEngineSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    double dFloat = FloatTotal(batch);
+    double dFloatSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int64_t nExpected = PricingEngine::TotalFromCounts(batch);
+
+#if defined(__AVX2__)
+    const char *szPath = "AVX2 gathers";
+#else
+    const char *szPath = "scalar lookups";
+#endif
+    std::cout << "=== " << nOrders << " orders, " << batch.Condiments().size() << " condiments, " << nThreads
+              << " threads, " << szPath << " ===\n";
+    std::cout << "Cents engine : " << dEngineSeconds * 1e9 / nOrders << " ns/order, total " << nCents << " cents\n";
+    std::cout << "Float prices : " << dFloatSeconds * 1e9 / nOrders << " ns/order, total " << std::fixed << dFloat * 100.0
+              << " cents\n";
+    std::cout << "From item counts: " << nExpected << " cents, reconciles: " << (nCents == nExpected ? "yes" : "no")
+              << "\n";
+    return nCents == nExpected ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+/*
+Decorated beverages compiled into a flat recipe.
+In decorator_pattern.cpp every condiment wraps the previous beverage, so Cost() recurses through the whole chain and
+GetDescription() builds a new std::string at every level, copying everything below it again.
+A Recipe stores the same information flat: the base, the list of condiments, and the running total and description
+length, updated as condiments are added. Cost() is a member read, the description is written once into a buffer of
+the exact size. RecipeBeverage adapts a Recipe back to the Component::Beverages interface.
+*/
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Component
+{
+    class Beverages
+    {
+    public:
+        virtual ~Beverages() = default;
+        virtual std::string GetDescription() = 0;
+        virtual double Cost() = 0;
+    };
+}
+
+/* Descriptions and prices, as in decorator_pattern.cpp */
+namespace Menu
+{
+    struct Item
+    {
+        std::string_view szDescription;
+        float fCost;
+    };
+
+    enum class Base
+    {
+        HouseBlend,
+        DarkRoast,
+        Espresso,
+        Decaf
+    };
+
+    enum class Condiment
+    {
+        Milk,
+        Mocha,
+        Soy,
+        Whip
+    };
+
+    constexpr Item kBases[] = {{"House Blend ", 1.22f}, {"Dark Roast ", 1.5f}, {"Espresso ", 1.5f}, {"Decaf ", 1.4f}};
+    constexpr Item kCondiments[] = {{"Milk ", .6f}, {" Mocha ", 0.5f}, {"Soy ", .4f}, {"Whip ", .5f}};
+
+    inline const Item &Lookup(Base eBase) { return kBases[static_cast<int>(eBase)]; }
+    inline const Item &Lookup(Condiment eCondiment) { return kCondiments[static_cast<int>(eCondiment)]; }
+}
+
+class Recipe
+{
+public:
+    explicit Recipe(Menu::Base eBase)
+        : m_eBase(eBase), m_dCost(Menu::Lookup(eBase).fCost), m_nDescriptionLength(Menu::Lookup(eBase).szDescription.size()) {}
+
+    /* Same as wrapping the beverage in one more decorator; the total is accumulated in the same order. */
+    Recipe &Add(Menu::Condiment eCondiment)
+    {
+        const Menu::Item &item = Menu::Lookup(eCondiment);
+        m_vCondiments.push_back(eCondiment);
+        m_dCost += item.fCost;
+        m_nDescriptionLength += item.szDescription.size();
+        return *this;
+    }
+
+    double Cost() const { return m_dCost; }
+    size_t DescriptionLength() const { return m_nDescriptionLength; }
+
+    /* Writes DescriptionLength() characters to pBuffer, no terminator. */
+    void WriteDescription(char *pBuffer) const
+    {
+        auto write = [&](std::string_view szPart)
+        {
+            std::memcpy(pBuffer, szPart.data(), szPart.size());
+            pBuffer += szPart.size();
+        };
+        write(Menu::Lookup(m_eBase).szDescription);
+        for (Menu::Condiment eCondiment : m_vCondiments)
+            write(Menu::Lookup(eCondiment).szDescription);
+    }
+
+    /* One allocation of the final size. */
+    std::string Description() const
+    {
+        std::string szDescription(m_nDescriptionLength, '\0');
+        WriteDescription(&szDescription[0]);
+        return szDescription;
+    }
+
+private:
+    Menu::Base m_eBase;
+    std::vector<Menu::Condiment> m_vCondiments;
+    double m_dCost;
+    size_t m_nDescriptionLength;
+};
+
+/* Compatibility adapter: a Recipe usable wherever a Component::Beverages is expected */
+class RecipeBeverage : public Component::Beverages
+{
+public:
+    explicit RecipeBeverage(Recipe recipe) : m_Recipe(std::move(recipe)) {}
+
+    std::string GetDescription() override { return m_Recipe.Description(); }
+    double Cost() override { return m_Recipe.Cost(); }
+    const Recipe &GetRecipe() const { return m_Recipe; }
+
+private:
+    Recipe m_Recipe;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* The decorator chain from decorator_pattern.cpp, for comparison */
+namespace Chain
+{
+    class Espresso : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Espresso "; }
+        double Cost() override { return 1.5f; }
+    };
+
+    class Mocha : public Component::Beverages
+    {
+    public:
+        Mocha(std::unique_ptr<Component::Beverages> beverage) : m_vBeverage(std::move(beverage)) {}
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + " Mocha "; }
+        double Cost() override { return 0.5f + m_vBeverage->Cost(); }
+
+    private:
+        std::unique_ptr<Component::Beverages> m_vBeverage;
+    };
+
+    class Milk : public Component::Beverages
+    {
+    public:
+        Milk(std::unique_ptr<Component::Beverages> beverage) : m_vBeverage(std::move(beverage)) {}
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + "Milk "; }
+        double Cost() override { return m_vBeverage->Cost() + .6f; }
+
+    private:
+        std::unique_ptr<Component::Beverages> m_vBeverage;
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    using Menu::Base;
+    using Menu::Condiment;
+
+    std::unique_ptr<Component::Beverages> beverage = std::make_unique<RecipeBeverage>(Recipe(Base::Espresso));
+    std::cout << beverage->GetDescription() << "$" << beverage->Cost() << "\n";
+
+    std::unique_ptr<Component::Beverages> beverage1 =
+        std::make_unique<RecipeBeverage>(Recipe(Base::DarkRoast).Add(Condiment::Mocha).Add(Condiment::Milk));
+    std::cout << beverage1->GetDescription() << "$" << beverage1->Cost() << "\n";
+
+    std::unique_ptr<Component::Beverages> beverage2 = std::make_unique<RecipeBeverage>(
+        Recipe(Base::HouseBlend).Add(Condiment::Mocha).Add(Condiment::Milk).Add(Condiment::Whip));
+    std::cout << beverage2->GetDescription() << "$" << beverage2->Cost() << "\n";
+
+    /* A long order both ways: alternating Mocha and Milk on an Espresso */
+    const int nCondiments = 200, nRepeats = 2000;
+    std::unique_ptr<Component::Beverages> chain = std::make_unique<Chain::Espresso>();
+    Recipe recipe(Base::Espresso);
+    for (int i = 0; i < nCondiments; ++i)
+    {
+        if (i % 2 == 0)
+        {
+            chain = std::make_unique<Chain::Mocha>(std::move(chain));
+            recipe.Add(Condiment::Mocha);
+        }
+        else
+        {
+            chain = std::make_unique<Chain::Milk>(std::move(chain));
+            recipe.Add(Condiment::Milk);
+        }
+    }
+    RecipeBeverage flat(recipe);
+
+    auto time = [&](Component::Beverages &order, size_t &nLength, double &dCost)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < nRepeats; ++repeat)
+        {
+            nLength += order.GetDescription().size();
+            dCost += order.Cost();
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / nRepeats;
+    };
+    size_t nChainLength = 0, nFlatLength = 0;
+    double dChainCost = 0.0, dFlatCost = 0.0;
+    double dChainUs = time(*chain, nChainLength, dChainCost);
+    double dFlatUs = time(flat, nFlatLength, dFlatCost);
+
+    std::cout << "=== Espresso with " << nCondiments << " condiments ===\n";
+    std::cout << "Decorator chain : " << dChainUs << " us per description + cost\n";
+    std::cout << "Flat recipe     : " << dFlatUs << " us per description + cost\n";
+    bool bSame = chain->GetDescription() == flat.GetDescription() && chain->Cost() == flat.Cost();
+    std::cout << "Same description and cost: " << (bSame ? "yes" : "no") << "\n";
+    return bSame ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+/*
+Hash consed decorator chains.
+In decorator_pattern.cpp a million orders of "House Blend, Mocha, Milk" are a million separate four node chains.
+Here beverages are immutable and made only through a BeverageFactory, which keeps one node per distinct
+(inner beverage, item) pair: asking twice for Milk on the same Mocha House Blend returns the same node. Orders share
+structure, memory grows with the number of distinct recipes, and two beverages are equal exactly when they are the
+same node, so equality and hashing are pointer operations.
+Description and cost are computed once, when a node is first made.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/* Counts heap bytes requested, to compare the memory each approach needs */
+static std::atomic<uint64_t> g_nAllocatedBytes{0};
+
+void *operator new(std::size_t nSize)
+{
+    g_nAllocatedBytes.fetch_add(nSize, std::memory_order_relaxed);
+    if (void *pMemory = std::malloc(nSize ? nSize : 1))
+        return pMemory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pMemory) noexcept { std::free(pMemory); }
+void operator delete(void *pMemory, std::size_t) noexcept { std::free(pMemory); }
+
+namespace Shared
+{
+    enum class Item : uint8_t
+    {
+        HouseBlend,
+        DarkRoast,
+        Espresso,
+        Decaf,
+        Milk,
+        Mocha,
+        Soy,
+        Whip,
+        Count
+    };
+
+    class BeverageFactory;
+
+    /* Immutable node; only the factory creates them. Compare and hash by address. */
+    class Beverage
+    {
+    public:
+        const std::string &GetDescription() const { return m_szDescription; }
+        double Cost() const { return m_dCost; }
+        const Beverage *Inner() const { return m_pInner; }
+        Item GetItem() const { return m_eItem; }
+
+    private:
+        friend class BeverageFactory;
+
+        Beverage(const Beverage *pInner, Item eItem, std::string szDescription, double dCost)
+            : m_pInner(pInner), m_eItem(eItem), m_szDescription(std::move(szDescription)), m_dCost(dCost) {}
+
+        const Beverage *m_pInner; // null for a base beverage
+        Item m_eItem;
+        std::string m_szDescription;
+        double m_dCost;
+    };
+
+    /* Owns every node. Thread safe; nodes live as long as the factory. */
+    class BeverageFactory
+    {
+    public:
+        /* A base beverage; null if eBase is not one. */
+        const Beverage *Make(Item eBase)
+        {
+            if (!IsBase(eBase))
+                return nullptr;
+            return Intern(nullptr, eBase);
+        }
+
+        /* The beverage pInner with one more condiment; null if pInner is null or eCondiment is not a condiment. */
+        const Beverage *Add(const Beverage *pInner, Item eCondiment)
+        {
+            if (!pInner || !IsCondiment(eCondiment))
+                return nullptr;
+            return Intern(pInner, eCondiment);
+        }
+
+        size_t DistinctNodes()
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_mNodes.size();
+        }
+
+    private:
+        struct Key
+        {
+            const Beverage *pInner;
+            Item eItem;
+            bool operator==(const Key &other) const { return pInner == other.pInner && eItem == other.eItem; }
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key &key) const
+            {
+                return std::hash<const Beverage *>()(key.pInner) * 31 + static_cast<size_t>(key.eItem);
+            }
+        };
+
+        static bool IsBase(Item eItem) { return eItem < Item::Milk; }
+        static bool IsCondiment(Item eItem) { return eItem >= Item::Milk && eItem < Item::Count; }
+
+        /* Only called with a valid (pInner, eItem) pair, so every entry holds a node. */
+        const Beverage *Intern(const Beverage *pInner, Item eItem)
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto &node = m_mNodes[Key{pInner, eItem}];
+            if (!node)
+                node.reset(Build(pInner, eItem));
+            return node.get();
+        }
+
+        /* Text and arithmetic as in decorator_pattern.cpp */
+        static Beverage *Build(const Beverage *pInner, Item eItem)
+        {
+            switch (eItem)
+            {
+            case Item::HouseBlend:
+                return new Beverage(nullptr, eItem, "House Blend ", 1.22f);
+            case Item::DarkRoast:
+                return new Beverage(nullptr, eItem, "Dark Roast ", 1.5f);
+            case Item::Espresso:
+                return new Beverage(nullptr, eItem, "Espresso ", 1.5f);
+            case Item::Decaf:
+                return new Beverage(nullptr, eItem, "Decaf ", 1.4f);
+            case Item::Milk:
+                return new Beverage(pInner, eItem, pInner->GetDescription() + "Milk ", pInner->Cost() + .6f);
+            case Item::Mocha:
+                return new Beverage(pInner, eItem, pInner->GetDescription() + " Mocha ", 0.5f + pInner->Cost());
+            case Item::Soy:
+                return new Beverage(pInner, eItem, pInner->GetDescription() + "Soy ", pInner->Cost() + .4f);
+            case Item::Whip:
+                return new Beverage(pInner, eItem, pInner->GetDescription() + "Whip ", pInner->Cost() + .5f);
+            default:
+                return nullptr;
+            }
+        }
+
+        std::mutex m_Mutex;
+        std::unordered_map<Key, std::unique_ptr<Beverage>, KeyHash> m_mNodes;
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* The decorator chain from decorator_pattern.cpp, for comparison */
+namespace Component
+{
+    class Beverages
+    {
+    public:
+        virtual ~Beverages() = default;
+        virtual std::string GetDescription() = 0;
+        virtual double Cost() = 0;
+    };
+}
+
+namespace Chain
+{
+    class Base : public Component::Beverages
+    {
+    public:
+        Base(std::string_view szDescription, double dCost) : m_szDescription(szDescription), m_dCost(dCost) {}
+        std::string GetDescription() override { return std::string(m_szDescription); }
+        double Cost() override { return m_dCost; }
+
+    private:
+        std::string_view m_szDescription;
+        double m_dCost;
+    };
+
+    class Condiment : public Component::Beverages
+    {
+    public:
+        Condiment(std::unique_ptr<Component::Beverages> beverage, std::string_view szName, float fPrice)
+            : m_vBeverage(std::move(beverage)), m_szName(szName), m_fPrice(fPrice) {}
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + std::string(m_szName); }
+        double Cost() override { return m_vBeverage->Cost() + m_fPrice; }
+
+    private:
+        std::unique_ptr<Component::Beverages> m_vBeverage;
+        std::string_view m_szName;
+        float m_fPrice;
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    using Shared::Item;
+    Shared::BeverageFactory factory;
+
+    const Shared::Beverage *beverage2 = factory.Make(Item::HouseBlend);
+    beverage2 = factory.Add(beverage2, Item::Mocha);
+    beverage2 = factory.Add(beverage2, Item::Milk);
+    beverage2 = factory.Add(beverage2, Item::Whip);
+    std::cout << beverage2->GetDescription() << "$" << beverage2->Cost() << "\n";
+
+    const Shared::Beverage *same = factory.Add(factory.Add(factory.Add(factory.Make(Item::HouseBlend), Item::Mocha), Item::Milk), Item::Whip);
+    std::cout << "Built twice, same node: " << (same == beverage2 ? "yes" : "no") << "\n";
+
+    size_t nNodes = factory.DistinctNodes();
+    bool bRejected = !factory.Make(Item::Milk) && !factory.Make(Item::Count) && !factory.Add(beverage2, Item::Espresso) &&
+                     !factory.Add(beverage2, Item::Count) && !factory.Add(nullptr, Item::Milk);
+    bRejected = bRejected && factory.DistinctNodes() == nNodes;
+    std::cout << "Invalid recipes rejected: " << (bRejected ? "yes" : "no") << "\n";
+
+    /* A million orders drawn from a small menu: a base and up to three condiments */
+    const int nOrders = 1000000;
+    auto recipe = [](int order, int slot)
+    {
+        uint32_t nHash = static_cast<uint32_t>(order) * 2654435761u;
+        if (slot == 0)
+            return static_cast<Item>(nHash % 4);
+        return static_cast<Item>(4 + (nHash >> (8 * slot)) % 4);
+    };
+    auto condiments = [](int order)
+    { return static_cast<int>((static_cast<uint32_t>(order) * 2654435761u >> 28) % 4); };
+
+    const char *aNames[] = {"House Blend ", "Dark Roast ", "Espresso ", "Decaf ", "Milk ", " Mocha ", "Soy ", "Whip "};
+    const float aPrices[] = {1.22f, 1.5f, 1.5f, 1.4f, .6f, .5f, .4f, .5f};
+
+    uint64_t nBefore = g_nAllocatedBytes;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Component::Beverages>> vChains;
+    vChains.reserve(nOrders);
+    for (int order = 0; order < nOrders; ++order)
+    {
+        Item eBase = recipe(order, 0);
+        std::unique_ptr<Component::Beverages> beverage =
+            std::make_unique<Chain::Base>(aNames[int(eBase)], aPrices[int(eBase)]);
+        for (int slot = 1; slot <= condiments(order); ++slot)
+        {
+            Item eCondiment = recipe(order, slot);
+            beverage = std::make_unique<Chain::Condiment>(std::move(beverage), aNames[int(eCondiment)], aPrices[int(eCondiment)]);
+        }
+        vChains.push_back(std::move(beverage));
+    }
+    double dChainSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t nChainBytes = g_nAllocatedBytes - nBefore;
+
+    nBefore = g_nAllocatedBytes;
+    start = std::chrono::steady_clock::now();
+    std::vector<const Shared::Beverage *> vShared;
+    vShared.reserve(nOrders);
+    for (int order = 0; order < nOrders; ++order)
+    {
+        const Shared::Beverage *beverage = factory.Make(recipe(order, 0));
+        for (int slot = 1; slot <= condiments(order); ++slot)
+            beverage = factory.Add(beverage, recipe(order, slot));
+        vShared.push_back(beverage);
+    }
+    double dSharedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t nSharedBytes = g_nAllocatedBytes - nBefore;
+
+    /* Distinct recipes: a hash set of node pointers */
+    std::unordered_set<const Shared::Beverage *> sRecipes(vShared.begin(), vShared.end());
+    double dChainTotal = 0.0, dSharedTotal = 0.0;
+    for (int order = 0; order < nOrders; ++order)
+    {
+        dChainTotal += vChains[order]->Cost();
+        dSharedTotal += vShared[order]->Cost();
+    }
+
+    std::cout << "=== " << nOrders << " orders, " << sRecipes.size() << " distinct recipes, " << factory.DistinctNodes()
+              << " shared nodes ===\n";
+    std::cout << "Own chain per order : " << nChainBytes / 1e6 << " MB, " << dChainSeconds * 1e9 / nOrders << " ns/order\n";
+    std::cout << "Hash consed         : " << nSharedBytes / 1e6 << " MB, " << dSharedSeconds * 1e9 / nOrders << " ns/order\n";
+    std::cout << "Same revenue: " << (dChainTotal == dSharedTotal ? "yes" : "no") << "\n";
+    return dChainTotal == dSharedTotal && same == beverage2 && bRejected ? 0 : 1;
+}
@@ -0,0 +1,371 @@
+/*
+Decorators that remember their result.
+In decorator_pattern.cpp every GetDescription() and Cost() walks the whole chain again, even when nothing in it has
+changed. Here each beverage computes its description and cost once and serves the cached value afterwards. A
+beverage knows the decorator wrapping it, so when it changes (a new price, a different inner beverage) it clears its
+own cache and the caches of everything above it; reads never walk the chain while the caches are warm.
+
+Two cache flavours share the same concrete beverages:
+ - Memoized::Beverages, for a beverage used by one thread;
+ - Memoized::SharedBeverages, for beverages shared across request threads: the cached result is an immutable
+   snapshot read with an atomic load, filling and invalidating a cache are serialised per beverage.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace Component
+{
+    class Beverages
+    {
+    public:
+        virtual ~Beverages() = default;
+        virtual std::string GetDescription() = 0;
+        virtual double Cost() = 0;
+    };
+}
+
+namespace Memoized
+{
+    template <typename Cached>
+    class CondimentsDecorator;
+
+    /* Single threaded cache */
+    class Beverages : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return Description(); }
+        double Cost() override
+        {
+            Refresh();
+            return m_dCost;
+        }
+        /* No copy, valid until the next change to this beverage or anything it wraps */
+        const std::string &Description()
+        {
+            Refresh();
+            return m_szDescription;
+        }
+
+    protected:
+        virtual std::string ComputeDescription() = 0;
+        virtual double ComputeCost() = 0;
+
+        /* Applies a change to this beverage and clears the caches that depend on it. */
+        template <typename Fn>
+        void Mutate(Fn &&change)
+        {
+            change();
+            Invalidate();
+        }
+
+    private:
+        template <typename Cached>
+        friend class CondimentsDecorator;
+
+        void Refresh()
+        {
+            if (m_bValid)
+                return;
+            m_szDescription = ComputeDescription();
+            m_dCost = ComputeCost();
+            m_bValid = true;
+        }
+
+        /* A valid beverage only ever wraps valid beverages, so the walk can stop at the first invalid one. */
+        void Invalidate()
+        {
+            for (Beverages *pBeverage = this; pBeverage && pBeverage->m_bValid; pBeverage = pBeverage->m_pOuter)
+                pBeverage->m_bValid = false;
+        }
+
+        Beverages *m_pOuter = nullptr; // the decorator wrapping this beverage, if any
+        bool m_bValid = false;
+        std::string m_szDescription;
+        double m_dCost = 0.0;
+    };
+
+    /* Thread safe cache */
+    class SharedBeverages : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return Snapshot()->szDescription; }
+        double Cost() override { return Snapshot()->dCost; }
+
+        struct Result
+        {
+            std::string szDescription;
+            double dCost;
+        };
+
+        /* Description and cost from the same moment; stays valid however the beverage changes afterwards */
+        std::shared_ptr<const Result> Snapshot()
+        {
+            std::shared_ptr<const Result> pResult = std::atomic_load_explicit(&m_pResult, std::memory_order_acquire);
+            if (pResult)
+                return pResult;
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            pResult = std::atomic_load_explicit(&m_pResult, std::memory_order_acquire);
+            if (!pResult)
+            {
+                pResult = std::make_shared<const Result>(Result{ComputeDescription(), ComputeCost()});
+                std::atomic_store_explicit(&m_pResult, pResult, std::memory_order_release);
+            }
+            return pResult;
+        }
+
+    protected:
+        virtual std::string ComputeDescription() = 0;
+        virtual double ComputeCost() = 0;
+
+        template <typename Fn>
+        void Mutate(Fn &&change)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                change();
+            }
+            Invalidate();
+        }
+
+    private:
+        template <typename Cached>
+        friend class CondimentsDecorator;
+
+        /* Locks one beverage at a time, inner to outer, while filling locks outer to inner: no lock cycle. A fill
+           that raced with the change finishes before its cache is cleared, so a stale result never survives. */
+        void Invalidate()
+        {
+            for (SharedBeverages *pBeverage = this; pBeverage; pBeverage = pBeverage->m_pOuter.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(pBeverage->m_Mutex);
+                std::atomic_store_explicit(&pBeverage->m_pResult, std::shared_ptr<const Result>(), std::memory_order_release);
+            }
+        }
+
+        std::atomic<SharedBeverages *> m_pOuter{nullptr};
+        std::mutex m_Mutex; // serialises filling, invalidating and changing this beverage
+        std::shared_ptr<const Result> m_pResult;
+    };
+
+    /* Base beverage with a price that can change */
+    template <typename Cached>
+    class Coffee : public Cached
+    {
+    public:
+        Coffee(std::string_view szDescription, double dCost) : m_szDescription(szDescription), m_dCost(dCost) {}
+
+        void SetCost(double dCost)
+        {
+            this->Mutate([&]
+                         { m_dCost = dCost; });
+        }
+
+    protected:
+        std::string ComputeDescription() override { return std::string(m_szDescription); }
+        double ComputeCost() override { return m_dCost; }
+
+    private:
+        std::string_view m_szDescription;
+        double m_dCost;
+    };
+
+    template <typename Cached>
+    class CondimentsDecorator : public Cached
+    {
+    public:
+        CondimentsDecorator(std::unique_ptr<Cached> beverage) { Link(std::move(beverage)); }
+
+        /* Replaces the wrapped beverage. */
+        void SetBeverage(std::unique_ptr<Cached> beverage)
+        {
+            std::unique_ptr<Cached> old; // destroyed after the change, outside any lock
+            this->Mutate([&]
+                         { old = Link(std::move(beverage)); });
+        }
+
+    protected:
+        Cached &Inner() { return *m_vBeverage; }
+
+    private:
+        std::unique_ptr<Cached> Link(std::unique_ptr<Cached> beverage)
+        {
+            beverage->m_pOuter = this;
+            std::swap(m_vBeverage, beverage);
+            return beverage;
+        }
+
+        std::unique_ptr<Cached> m_vBeverage;
+    };
+}
+
+namespace ConcreteComponents
+{
+    template <typename Cached>
+    class HouseBlend : public Memoized::Coffee<Cached>
+    {
+    public:
+        HouseBlend() : Memoized::Coffee<Cached>("House Blend ", 1.22f) {}
+    };
+
+    template <typename Cached>
+    class DarkRoast : public Memoized::Coffee<Cached>
+    {
+    public:
+        DarkRoast() : Memoized::Coffee<Cached>("Dark Roast ", 1.5f) {}
+    };
+
+    template <typename Cached>
+    class Espresso : public Memoized::Coffee<Cached>
+    {
+    public:
+        Espresso() : Memoized::Coffee<Cached>("Espresso ", 1.5f) {}
+    };
+
+    template <typename Cached>
+    class Decaf : public Memoized::Coffee<Cached>
+    {
+    public:
+        Decaf() : Memoized::Coffee<Cached>("Decaf ", 1.4f) {}
+    };
+}
+
+namespace ConcreteDecorators
+{
+    template <typename Cached>
+    class Milk : public Memoized::CondimentsDecorator<Cached>
+    {
+    public:
+        using Memoized::CondimentsDecorator<Cached>::CondimentsDecorator;
+
+    protected:
+        std::string ComputeDescription() override { return this->Inner().GetDescription() + "Milk "; }
+        double ComputeCost() override { return this->Inner().Cost() + .6f; }
+    };
+
+    template <typename Cached>
+    class Mocha : public Memoized::CondimentsDecorator<Cached>
+    {
+    public:
+        using Memoized::CondimentsDecorator<Cached>::CondimentsDecorator;
+
+    protected:
+        std::string ComputeDescription() override { return this->Inner().GetDescription() + " Mocha "; }
+        double ComputeCost() override { return 0.5f + this->Inner().Cost(); }
+    };
+
+    template <typename Cached>
+    class Soy : public Memoized::CondimentsDecorator<Cached>
+    {
+    public:
+        using Memoized::CondimentsDecorator<Cached>::CondimentsDecorator;
+
+    protected:
+        std::string ComputeDescription() override { return this->Inner().GetDescription() + "Soy "; }
+        double ComputeCost() override { return this->Inner().Cost() + .4f; }
+    };
+
+    template <typename Cached>
+    class Whip : public Memoized::CondimentsDecorator<Cached>
+    {
+    public:
+        using Memoized::CondimentsDecorator<Cached>::CondimentsDecorator;
+
+    protected:
+        std::string ComputeDescription() override { return this->Inner().GetDescription() + "Whip "; }
+        double ComputeCost() override { return this->Inner().Cost() + .5f; }
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* HouseBlend with nCondiments alternating Mocha and Milk; pBase receives the base so its price can be changed. */
+template <typename Cached>
+std::unique_ptr<Cached> MakeOrder(int nCondiments, Memoized::Coffee<Cached> *&pBase)
+{
+    auto base = std::make_unique<ConcreteComponents::HouseBlend<Cached>>();
+    pBase = base.get();
+    std::unique_ptr<Cached> beverage = std::move(base);
+    for (int i = 0; i < nCondiments; ++i)
+    {
+        if (i % 2 == 0)
+            beverage = std::make_unique<ConcreteDecorators::Mocha<Cached>>(std::move(beverage));
+        else
+            beverage = std::make_unique<ConcreteDecorators::Milk<Cached>>(std::move(beverage));
+    }
+    return beverage;
+}
+
+int main()
+{
+    using Memoized::Beverages;
+    using Memoized::SharedBeverages;
+
+    std::unique_ptr<Beverages> beverage2 = std::make_unique<ConcreteComponents::HouseBlend<Beverages>>();
+    beverage2 = std::make_unique<ConcreteDecorators::Mocha<Beverages>>(std::move(beverage2));
+    beverage2 = std::make_unique<ConcreteDecorators::Milk<Beverages>>(std::move(beverage2));
+    auto *pWhip = new ConcreteDecorators::Whip<Beverages>(std::move(beverage2));
+    beverage2.reset(pWhip);
+    std::cout << beverage2->GetDescription() << "$" << beverage2->Cost() << "\n";
+    pWhip->SetBeverage(std::make_unique<ConcreteDecorators::Soy<Beverages>>(std::make_unique<ConcreteComponents::Decaf<Beverages>>()));
+    std::cout << beverage2->GetDescription() << "$" << beverage2->Cost() << "\n";
+
+    /* Cold versus warm reads of a long order */
+    const int nCondiments = 200, nReads = 100000;
+    Memoized::Coffee<Beverages> *pBase = nullptr;
+    std::unique_ptr<Beverages> order = MakeOrder<Beverages>(nCondiments, pBase);
+    auto start = std::chrono::steady_clock::now();
+    double dFirst = order->Cost();
+    double dColdUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    size_t nLength = 0;
+    start = std::chrono::steady_clock::now();
+    for (int read = 0; read < nReads; ++read)
+        nLength += order->Description().size() + (order->Cost() == dFirst);
+    double dWarmNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / nReads;
+    pBase->SetCost(2.0);
+    std::cout << "=== HouseBlend with " << nCondiments << " condiments ===\n";
+    std::cout << "First read " << dColdUs << " us, cached reads " << dWarmNs << " ns\n";
+    std::cout << "Cost $" << dFirst << ", after the base price changes $" << order->Cost() << "\n";
+
+    /* Shared order: readers on every thread while the base price flips between two values */
+    Memoized::Coffee<SharedBeverages> *pSharedBase = nullptr;
+    std::unique_ptr<SharedBeverages> shared = MakeOrder<SharedBeverages>(nCondiments, pSharedBase);
+    const double dLow = shared->Cost();
+    pSharedBase->SetCost(2.0);
+    const double dHigh = shared->Cost();
+
+    std::atomic<bool> bRunning{true};
+    std::atomic<uint64_t> nReadsDone{0}, nBad{0};
+    std::vector<std::thread> vReaders;
+    for (unsigned t = 0; t < std::max(2u, std::thread::hardware_concurrency()); ++t)
+        vReaders.emplace_back([&]
+                              {
+            while (bRunning.load(std::memory_order_relaxed))
+            {
+                double dCost = shared->Cost();
+                if (dCost != dLow && dCost != dHigh)
+                    ++nBad;
+                ++nReadsDone;
+            } });
+    for (int change = 0; change < 200; ++change)
+    {
+        pSharedBase->SetCost(change % 2 ? 2.0 : 1.22f);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    pSharedBase->SetCost(1.22f);
+    bRunning = false;
+    for (auto &reader : vReaders)
+        reader.join();
+
+    bool bFresh = shared->Cost() == dLow;
+    std::cout << "Shared order: " << nReadsDone << " reads during 200 price changes, " << nBad
+              << " impossible totals, final total fresh: " << (bFresh ? "yes" : "no") << "\n";
+    return nBad == 0 && bFresh ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+/*
+Decorators allocated from a per thread arena.
+In decorator_pattern.cpp an order with three condiments is four std::make_unique calls, and destroying it is four
+frees in pointer chasing order. Here beverages and decorators are placed in the calling thread's Arena, a
+std::pmr::monotonic_buffer_resource over a buffer that is reused from order to order:
+ - Arena::Make<T>() constructs in the arena and returns a Pooled<T>, a std::unique_ptr whose deleter only runs the
+   destructor, so a decorator chain is still owned the usual way;
+ - an OrderScope marks one order; when it ends the arena is rewound, which frees the whole order in one step.
+main counts calls to operator new to report allocations per order before and after.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Counts every heap allocation in the process */
+static std::atomic<uint64_t> g_nAllocations{0};
+
+void *operator new(std::size_t nSize)
+{
+    g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pMemory = std::malloc(nSize ? nSize : 1))
+        return pMemory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pMemory) noexcept { std::free(pMemory); }
+void operator delete(void *pMemory, std::size_t) noexcept { std::free(pMemory); }
+
+/* Arena memory is given back by rewinding the arena, so deleting a node only destroys it. */
+struct DestroyOnly
+{
+    template <typename T>
+    void operator()(T *pObject) const { pObject->~T(); }
+};
+
+template <typename T>
+using Pooled = std::unique_ptr<T, DestroyOnly>;
+
+class Arena
+{
+public:
+    explicit Arena(size_t nBytes) : m_vBuffer(nBytes), m_Resource(m_vBuffer.data(), m_vBuffer.size()) {}
+
+    static Arena &ForThisThread()
+    {
+        thread_local Arena arena(64 * 1024);
+        return arena;
+    }
+
+    template <typename T, typename... Args>
+    Pooled<T> Make(Args &&...args)
+    {
+        void *pMemory = m_Resource.allocate(sizeof(T), alignof(T));
+        return Pooled<T>(new (pMemory) T(std::forward<Args>(args)...));
+    }
+
+    /* Frees everything made since the last rewind; the objects must have been destroyed already. */
+    void Rewind() { m_Resource.release(); }
+
+private:
+    friend class OrderScope;
+
+    std::vector<std::byte> m_vBuffer;
+    unsigned m_nOpenScopes = 0;
+    std::pmr::monotonic_buffer_resource m_Resource; // falls back to the heap if an order outgrows the buffer
+};
+
+/*
+ * One order's lifetime: declare it before the order's beverages so they are destroyed first.
+ * Scopes on one arena do not nest: rewinding an inner scope would also free the outer order, so opening a second
+ * scope while one is open terminates.
+ */
+class OrderScope
+{
+public:
+    explicit OrderScope(Arena &arena = Arena::ForThisThread()) : m_Arena(arena)
+    {
+        if (m_Arena.m_nOpenScopes++ != 0)
+            std::terminate(); // nested OrderScope
+    }
+    ~OrderScope()
+    {
+        --m_Arena.m_nOpenScopes;
+        m_Arena.Rewind();
+    }
+    OrderScope(const OrderScope &) = delete;
+    OrderScope &operator=(const OrderScope &) = delete;
+
+    Arena &GetArena() { return m_Arena; }
+
+private:
+    Arena &m_Arena;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+namespace Component
+{
+    class Beverages
+    {
+    public:
+        virtual ~Beverages() = default;
+        virtual std::string GetDescription() = 0;
+        virtual double Cost() = 0;
+    };
+}
+
+namespace ConcreteComponents
+{
+    class HouseBlend : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "House Blend "; }
+        double Cost() override { return 1.22f; }
+    };
+
+    class DarkRoast : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Dark Roast "; }
+        double Cost() override { return 1.5f; }
+    };
+
+    class Espresso : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Espresso "; }
+        double Cost() override { return 1.5f; }
+    };
+
+    class Decaf : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Decaf "; }
+        double Cost() override { return 1.4f; }
+    };
+}
+
+namespace Decorator
+{
+    /* Owns the wrapped beverage through Handle, a std::unique_ptr or a Pooled pointer. */
+    template <typename Handle>
+    class CondimentsDecorator : public Component::Beverages
+    {
+    public:
+        CondimentsDecorator(Handle beverage) : m_vBeverage(std::move(beverage)) {}
+
+    protected:
+        Handle m_vBeverage;
+    };
+}
+
+namespace ConcreteDecorators
+{
+    template <typename Handle>
+    class Milk : public Decorator::CondimentsDecorator<Handle>
+    {
+    public:
+        using Decorator::CondimentsDecorator<Handle>::CondimentsDecorator;
+        std::string GetDescription() override { return this->m_vBeverage->GetDescription() + "Milk "; }
+        double Cost() override { return this->m_vBeverage->Cost() + .6f; }
+    };
+
+    template <typename Handle>
+    class Mocha : public Decorator::CondimentsDecorator<Handle>
+    {
+    public:
+        using Decorator::CondimentsDecorator<Handle>::CondimentsDecorator;
+        std::string GetDescription() override { return this->m_vBeverage->GetDescription() + " Mocha "; }
+        double Cost() override { return 0.5f + this->m_vBeverage->Cost(); }
+    };
+
+    template <typename Handle>
+    class Soy : public Decorator::CondimentsDecorator<Handle>
+    {
+    public:
+        using Decorator::CondimentsDecorator<Handle>::CondimentsDecorator;
+        std::string GetDescription() override { return this->m_vBeverage->GetDescription() + "Soy "; }
+        double Cost() override { return this->m_vBeverage->Cost() + .4f; }
+    };
+
+    template <typename Handle>
+    class Whip : public Decorator::CondimentsDecorator<Handle>
+    {
+    public:
+        using Decorator::CondimentsDecorator<Handle>::CondimentsDecorator;
+        std::string GetDescription() override { return this->m_vBeverage->GetDescription() + "Whip "; }
+        double Cost() override { return this->m_vBeverage->Cost() + .5f; }
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    using Heap = std::unique_ptr<Component::Beverages>;
+    using InArena = Pooled<Component::Beverages>;
+    using namespace ConcreteDecorators;
+
+    {
+        OrderScope order;
+        Arena &arena = order.GetArena();
+        InArena beverage2 = arena.Make<ConcreteComponents::HouseBlend>();
+        beverage2 = arena.Make<Mocha<InArena>>(std::move(beverage2));
+        beverage2 = arena.Make<Milk<InArena>>(std::move(beverage2));
+        beverage2 = arena.Make<Whip<InArena>>(std::move(beverage2));
+        std::cout << beverage2->GetDescription() << "$" << beverage2->Cost() << "\n";
+    }
+
+    /* Build, price and drop a House Blend with Mocha, Milk, Soy and Whip, nOrders times */
+    const int nOrders = 5000000;
+    using Clock = std::chrono::steady_clock;
+    double dHeapTotal = 0.0, dPooledTotal = 0.0;
+
+    uint64_t nBefore = g_nAllocations;
+    auto start = Clock::now();
+    for (int i = 0; i < nOrders; ++i)
+    {
+        Heap beverage = std::make_unique<ConcreteComponents::HouseBlend>();
+        beverage = std::make_unique<Mocha<Heap>>(std::move(beverage));
+        beverage = std::make_unique<Milk<Heap>>(std::move(beverage));
+        beverage = std::make_unique<Soy<Heap>>(std::move(beverage));
+        beverage = std::make_unique<Whip<Heap>>(std::move(beverage));
+        dHeapTotal += beverage->Cost();
+    }
+    double dHeapSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double dHeapAllocations = double(g_nAllocations - nBefore) / nOrders;
+
+    Arena::ForThisThread(); // first touch of the thread's arena, outside the measurement
+    nBefore = g_nAllocations;
+    start = Clock::now();
+    for (int i = 0; i < nOrders; ++i)
+    {
+        OrderScope order;
+        Arena &arena = order.GetArena();
+        InArena beverage = arena.Make<ConcreteComponents::HouseBlend>();
+        beverage = arena.Make<Mocha<InArena>>(std::move(beverage));
+        beverage = arena.Make<Milk<InArena>>(std::move(beverage));
+        beverage = arena.Make<Soy<InArena>>(std::move(beverage));
+        beverage = arena.Make<Whip<InArena>>(std::move(beverage));
+        dPooledTotal += beverage->Cost();
+    }
+    double dPooledSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    double dPooledAllocations = double(g_nAllocations - nBefore) / nOrders;
+
+    std::cout << "=== " << nOrders << " orders of House Blend with four condiments ===\n";
+    std::cout << "make_unique : " << dHeapAllocations << " allocations/order, " << nOrders / dHeapSeconds / 1e6
+              << " M orders/s\n";
+    std::cout << "Arena       : " << dPooledAllocations << " allocations/order, " << nOrders / dPooledSeconds / 1e6
+              << " M orders/s\n";
+    return dHeapTotal == dPooledTotal && dPooledAllocations == 0.0 ? 0 : 1;
+}
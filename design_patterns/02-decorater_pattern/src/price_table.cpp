@@ -0,0 +1,341 @@
+/*
+Decorators priced from a hot reloadable price table.
+In decorator_pattern.cpp every price is a literal inside a Cost() override, so changing the price of Milk means a
+redeploy. Here prices come from a file:
+
+    # item     price
+    DarkRoast  1.50
+    Milk       0.60
+
+PriceBook loads the file into an immutable PriceSnapshot and publishes it through an atomic pointer. Pricing threads
+pin the current epoch and read the snapshot with one atomic load, with no lock and no reference count. An order passes
+the same snapshot down its whole decorator chain, so it is always priced against a single version of the table.
+Replaced snapshots are freed with epoch based reclamation once no pricing thread can still be reading them.
+*/
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../../common/epoch_manager.h"
+
+/* PRICES */
+enum class Item
+{
+    HouseBlend,
+    DarkRoast,
+    Espresso,
+    Decaf,
+    Milk,
+    Mocha,
+    Soy,
+    Whip,
+    Count
+};
+
+constexpr std::array<const char *, static_cast<size_t>(Item::Count)> kItemNames = {
+    "HouseBlend", "DarkRoast", "Espresso", "Decaf", "Milk", "Mocha", "Soy", "Whip"};
+
+/* One version of the price table. Never modified after it is published. */
+class PriceSnapshot
+{
+public:
+    /* Returns nullptr and reports the offending line if the file is unreadable, malformed or incomplete. */
+    static std::unique_ptr<PriceSnapshot> Load(const std::string &szPath, uint64_t nVersion)
+    {
+        std::ifstream file(szPath);
+        if (!file)
+        {
+            std::cerr << "Cannot open price table: " << szPath << "\n";
+            return nullptr;
+        }
+
+        auto snapshot = std::unique_ptr<PriceSnapshot>(new PriceSnapshot(nVersion));
+        std::array<bool, static_cast<size_t>(Item::Count)> aSeen{};
+        std::string szLine;
+        for (int nLine = 1; std::getline(file, szLine); ++nLine)
+        {
+            std::istringstream line(szLine.substr(0, szLine.find('#')));
+            std::string szName;
+            double dPrice;
+            if (!(line >> szName))
+                continue;
+            auto it = std::find(kItemNames.begin(), kItemNames.end(), szName);
+            if (it == kItemNames.end() || !(line >> dPrice) || dPrice < 0.0)
+            {
+                std::cerr << szPath << ":" << nLine << ": invalid price line: " << szLine << "\n";
+                return nullptr;
+            }
+            size_t nItem = static_cast<size_t>(it - kItemNames.begin());
+            snapshot->m_aPrice[nItem] = dPrice;
+            aSeen[nItem] = true;
+        }
+        for (size_t item = 0; item < aSeen.size(); ++item)
+            if (!aSeen[item])
+            {
+                std::cerr << szPath << ": no price for " << kItemNames[item] << "\n";
+                return nullptr;
+            }
+        return snapshot;
+    }
+
+    uint64_t Version() const { return m_nVersion; }
+    double Price(Item eItem) const { return m_aPrice[static_cast<size_t>(eItem)]; }
+
+private:
+    explicit PriceSnapshot(uint64_t nVersion) : m_nVersion(nVersion) {}
+
+    uint64_t m_nVersion;
+    std::array<double, static_cast<size_t>(Item::Count)> m_aPrice{};
+};
+
+/* Owns the current snapshot; readers must hold an EpochManager::Guard from Pin() while they use it. */
+class PriceBook
+{
+public:
+    /* Throws std::runtime_error when the file cannot be loaded: there are no prices to start with. */
+    PriceBook(EpochManager &epochs, std::string szPath) : m_Epochs(epochs), m_szPath(std::move(szPath))
+    {
+        if (!Reload())
+            throw std::runtime_error("PriceBook: cannot load initial prices from " + m_szPath);
+    }
+
+    ~PriceBook() { delete m_pCurrent.load(); }
+
+    EpochManager::Guard Pin() { return m_Epochs.Pin(); }
+    const PriceSnapshot &Current() const { return *m_pCurrent.load(std::memory_order_acquire); }
+
+    /* Loads the file and publishes it. A bad file is reported and the current prices stay in force. */
+    bool Reload()
+    {
+        std::lock_guard<std::mutex> lock(m_ReloadMutex);
+        const PriceSnapshot *pCurrent = m_pCurrent.load();
+        std::unique_ptr<PriceSnapshot> snapshot = PriceSnapshot::Load(m_szPath, pCurrent ? pCurrent->Version() + 1 : 1);
+        if (!snapshot)
+            return false;
+        std::error_code error;
+        m_LastWrite = std::filesystem::last_write_time(m_szPath, error);
+
+        const PriceSnapshot *pOld = m_pCurrent.exchange(snapshot.release(), std::memory_order_seq_cst);
+        if (pOld)
+            m_Epochs.Retire([pOld]
+                            { delete pOld; });
+        return true;
+    }
+
+    /* For a polling loop: reloads only when the file's modification time has changed. */
+    bool ReloadIfChanged()
+    {
+        std::error_code error;
+        auto lastWrite = std::filesystem::last_write_time(m_szPath, error);
+        {
+            std::lock_guard<std::mutex> lock(m_ReloadMutex);
+            if (error || lastWrite == m_LastWrite)
+                return false;
+        }
+        return Reload();
+    }
+
+private:
+    EpochManager &m_Epochs;
+    std::string m_szPath;
+    std::atomic<const PriceSnapshot *> m_pCurrent{nullptr};
+    std::mutex m_ReloadMutex; // serialises writers only
+    std::filesystem::file_time_type m_LastWrite;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+namespace Component
+{
+    class Beverages
+    {
+    public:
+        virtual ~Beverages() = default;
+        virtual std::string GetDescription() = 0;
+        /* Every layer of one order reads the same snapshot. */
+        virtual double Cost(const PriceSnapshot &prices) = 0;
+    };
+}
+
+namespace ConcreteComponents
+{
+    class HouseBlend : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "House Blend "; }
+        double Cost(const PriceSnapshot &prices) override { return prices.Price(Item::HouseBlend); }
+    };
+
+    class DarkRoast : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Dark Roast "; }
+        double Cost(const PriceSnapshot &prices) override { return prices.Price(Item::DarkRoast); }
+    };
+
+    class Espresso : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Espresso "; }
+        double Cost(const PriceSnapshot &prices) override { return prices.Price(Item::Espresso); }
+    };
+
+    class Decaf : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Decaf "; }
+        double Cost(const PriceSnapshot &prices) override { return prices.Price(Item::Decaf); }
+    };
+}
+
+namespace Decorator
+{
+    class CondimentsDecorator : public Component::Beverages
+    {
+    public:
+        CondimentsDecorator(std::unique_ptr<Component::Beverages> beverage) : m_vBeverage(std::move(beverage)) {}
+
+    protected:
+        std::unique_ptr<Component::Beverages> m_vBeverage;
+    };
+}
+
+namespace ConcreteDecorators
+{
+    class Milk : public Decorator::CondimentsDecorator
+    {
+    public:
+        using CondimentsDecorator::CondimentsDecorator;
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + "Milk "; }
+        double Cost(const PriceSnapshot &prices) override { return m_vBeverage->Cost(prices) + prices.Price(Item::Milk); }
+    };
+
+    class Mocha : public Decorator::CondimentsDecorator
+    {
+    public:
+        using CondimentsDecorator::CondimentsDecorator;
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + " Mocha "; }
+        double Cost(const PriceSnapshot &prices) override { return prices.Price(Item::Mocha) + m_vBeverage->Cost(prices); }
+    };
+
+    class Soy : public Decorator::CondimentsDecorator
+    {
+    public:
+        using CondimentsDecorator::CondimentsDecorator;
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + "Soy "; }
+        double Cost(const PriceSnapshot &prices) override { return m_vBeverage->Cost(prices) + prices.Price(Item::Soy); }
+    };
+
+    class Whip : public Decorator::CondimentsDecorator
+    {
+    public:
+        using CondimentsDecorator::CondimentsDecorator;
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + "Whip "; }
+        double Cost(const PriceSnapshot &prices) override { return m_vBeverage->Cost(prices) + prices.Price(Item::Whip); }
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Price list number nList: every price is the base menu price times nList, so a mixed order is easy to spot. */
+void WritePriceFile(const std::string &szPath, int nList)
+{
+    const double aBase[] = {1.22, 1.5, 1.5, 1.4, .6, .5, .4, .5};
+    std::ofstream file(szPath + ".tmp");
+    file << "# item price, list " << nList << "\n";
+    for (size_t item = 0; item < kItemNames.size(); ++item)
+        file << kItemNames[item] << " " << aBase[item] * nList << "\n";
+    file.close();
+    std::filesystem::rename(szPath + ".tmp", szPath); // readers of the file never see half of it
+}
+
+int main()
+{
+    const std::string szPath = (std::filesystem::temp_directory_path() / "price_table.txt").string();
+    WritePriceFile(szPath, 1);
+
+    EpochManager epochs;
+    std::unique_ptr<PriceBook> book;
+    try
+    {
+        book = std::make_unique<PriceBook>(epochs, szPath);
+    }
+    catch (const std::runtime_error &error)
+    {
+        std::cerr << error.what() << "\n";
+        return 1;
+    }
+    PriceBook &prices = *book;
+
+    std::unique_ptr<Component::Beverages> beverage2 = std::make_unique<ConcreteComponents::HouseBlend>();
+    beverage2 = std::make_unique<ConcreteDecorators::Mocha>(std::move(beverage2));
+    beverage2 = std::make_unique<ConcreteDecorators::Milk>(std::move(beverage2));
+    beverage2 = std::make_unique<ConcreteDecorators::Whip>(std::move(beverage2));
+    {
+        auto guard = prices.Pin();
+        std::cout << beverage2->GetDescription() << "$" << beverage2->Cost(prices.Current()) << "\n";
+    }
+
+    /* The price of this order on list n is n times its list 1 price. */
+    const double dListOne = [&]
+    {
+        auto guard = prices.Pin();
+        return beverage2->Cost(prices.Current());
+    }();
+
+    std::atomic<bool> bRunning{true};
+    std::atomic<uint64_t> nOrders{0}, nMixed{0};
+    std::vector<std::thread> vCashiers;
+    unsigned nThreads = std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < nThreads; ++t)
+        vCashiers.emplace_back([&]
+                               {
+            while (bRunning.load(std::memory_order_relaxed))
+            {
+                auto guard = prices.Pin();
+                const PriceSnapshot &snapshot = prices.Current();
+                double dCost = beverage2->Cost(snapshot);
+                int nList = static_cast<int>(snapshot.Price(Item::HouseBlend) / 1.22 + 0.5);
+                if (std::abs(dCost - dListOne * nList) > 1e-9)
+                    ++nMixed;
+                nOrders.fetch_add(1, std::memory_order_relaxed);
+            } });
+
+    /* Prices change during the day: rewrite the file and let the poller pick it up. */
+    int nReloads = 0;
+    for (int nList = 2; nList <= 20; ++nList)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        WritePriceFile(szPath, nList);
+        nReloads += prices.Reload();
+    }
+    {
+        std::ofstream broken(szPath, std::ios::app);
+        broken << "Caramel 0.70\n";
+    }
+    bool bRejected = !prices.ReloadIfChanged();
+
+    bRunning = false;
+    for (auto &cashier : vCashiers)
+        cashier.join();
+    epochs.Collect();
+    std::filesystem::remove(szPath);
+
+    std::cout << "=== " << nOrders << " orders on " << nThreads << " threads across " << nReloads << " reloads ===\n";
+    std::cout << "Orders priced with a mix of price lists: " << nMixed << "\n";
+    std::cout << "Bad price file rejected, still on version " << prices.Current().Version() << ": "
+              << (bRejected ? "yes" : "no") << "\n";
+    return nMixed == 0 && bRejected ? 0 : 1;
+}
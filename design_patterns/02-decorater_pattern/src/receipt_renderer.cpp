@@ -0,0 +1,321 @@
+/*
+Rendering receipts in batches.
+In decorator_pattern.cpp a receipt line is GetDescription(), a std::string grown with + at every decorator, streamed
+to std::cout together with a double. Printing millions of receipts that way is mostly string building and iostream
+formatting.
+
+ReceiptRenderer formats a whole batch of orders straight into one output buffer that is reused between batches:
+names are interned once as (pointer, length) pairs and copied with memcpy, prices are integer cents formatted with a
+two digits at a time table, and the finished batch is handed to the kernel with a single write. The line reads as in
+decorator_pattern.cpp, except that prices always show two decimals, as on a till receipt.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+/* Menu: descriptions as in decorator_pattern.cpp, prices in cents */
+namespace Menu
+{
+    enum Base : uint8_t
+    {
+        HouseBlend,
+        DarkRoast,
+        Espresso,
+        Decaf,
+        BaseCount
+    };
+
+    enum Condiment : uint8_t
+    {
+        Milk,
+        Mocha,
+        Soy,
+        Whip,
+        CondimentCount
+    };
+
+    constexpr std::array<std::string_view, BaseCount> kBaseNames = {"House Blend ", "Dark Roast ", "Espresso ", "Decaf "};
+    constexpr std::array<std::string_view, CondimentCount> kCondimentNames = {"Milk ", " Mocha ", "Soy ", "Whip "};
+    constexpr std::array<uint32_t, BaseCount> kBaseCents = {122, 150, 150, 140};
+    constexpr std::array<uint32_t, CondimentCount> kCondimentCents = {60, 50, 40, 50};
+}
+
+/*
+ * Orders as columns: order i is Bases()[i] with condiments Condiments()[Offsets()[i] .. Offsets()[i + 1]).
+ * Add rejects ids outside the menu, so Render can index the name and price tables without checks.
+ */
+class OrderBatch
+{
+public:
+    size_t Size() const { return m_vBase.size(); }
+    const std::vector<uint8_t> &Bases() const { return m_vBase; }
+    const std::vector<uint32_t> &Offsets() const { return m_vOffset; }
+    const std::vector<uint8_t> &Condiments() const { return m_vCondiments; }
+
+    void Add(uint8_t nBase, std::initializer_list<uint8_t> condiments) { Add(nBase, condiments.begin(), condiments.size()); }
+
+    void Add(uint8_t nBase, const uint8_t *pCondiments, size_t nCondiments)
+    {
+        if (nBase >= Menu::BaseCount)
+            throw std::invalid_argument("OrderBatch: unknown base id");
+        for (size_t i = 0; i < nCondiments; ++i)
+            if (pCondiments[i] >= Menu::CondimentCount)
+                throw std::invalid_argument("OrderBatch: unknown condiment id");
+        if (nCondiments > std::numeric_limits<uint32_t>::max() - m_vCondiments.size())
+            throw std::length_error("OrderBatch: too many condiments for 32-bit offsets");
+
+        m_vBase.push_back(nBase);
+        m_vCondiments.insert(m_vCondiments.end(), pCondiments, pCondiments + nCondiments);
+        m_vOffset.push_back(static_cast<uint32_t>(m_vCondiments.size()));
+    }
+
+private:
+    std::vector<uint8_t> m_vBase;
+    std::vector<uint32_t> m_vOffset{0};
+    std::vector<uint8_t> m_vCondiments;
+};
+
+class ReceiptRenderer
+{
+public:
+    ReceiptRenderer()
+    {
+        m_vNames.reserve(static_cast<size_t>(Menu::BaseCount) + Menu::CondimentCount);
+        for (size_t base = 0; base < Menu::BaseCount; ++base)
+        {
+            m_aBase[base] = Intern(Menu::kBaseNames[base]);
+            m_nLongestBase = std::max<size_t>(m_nLongestBase, m_aBase[base].nLength);
+        }
+        for (size_t condiment = 0; condiment < Menu::CondimentCount; ++condiment)
+        {
+            m_aCondiment[condiment] = Intern(Menu::kCondimentNames[condiment]);
+            m_nLongestCondiment = std::max<size_t>(m_nLongestCondiment, m_aCondiment[condiment].nLength);
+        }
+        for (int i = 0; i < 100; ++i)
+        {
+            m_aDigitPairs[2 * i] = static_cast<char>('0' + i / 10);
+            m_aDigitPairs[2 * i + 1] = static_cast<char>('0' + i % 10);
+        }
+    }
+
+    /* Appends one line per order to the buffer: "<description>$<dollars>.<cents>\n". */
+    void Render(const OrderBatch &batch)
+    {
+        /* Size the buffer once for the worst case, write through a raw pointer, then trim to what was written. */
+        size_t nWorstCase = batch.Size() * (m_nLongestBase + 1 + kMaxPriceDigits + 1) +
+                            batch.Condiments().size() * m_nLongestCondiment;
+        Reserve(m_nSize + nWorstCase);
+        char *pOut = m_pBuffer.get() + m_nSize;
+
+        const std::vector<uint8_t> &vBase = batch.Bases(), &vCondiments = batch.Condiments();
+        const std::vector<uint32_t> &vOffset = batch.Offsets();
+        for (size_t order = 0; order < batch.Size(); ++order)
+        {
+            const Name &base = m_aBase[vBase[order]];
+            std::memcpy(pOut, base.pText, base.nLength);
+            pOut += base.nLength;
+            uint32_t nCents = Menu::kBaseCents[vBase[order]];
+            for (uint32_t i = vOffset[order]; i < vOffset[order + 1]; ++i)
+            {
+                const Name &condiment = m_aCondiment[vCondiments[i]];
+                std::memcpy(pOut, condiment.pText, condiment.nLength);
+                pOut += condiment.nLength;
+                nCents += Menu::kCondimentCents[vCondiments[i]];
+            }
+            *pOut++ = '$';
+            pOut = FormatCents(pOut, nCents);
+            *pOut++ = '\n';
+        }
+        m_nSize = static_cast<size_t>(pOut - m_pBuffer.get());
+    }
+
+    /* Hands everything rendered so far to fd in as few write calls as the kernel allows (normally one). */
+    bool Flush(int fd)
+    {
+        const char *pData = m_pBuffer.get();
+        size_t nLeft = m_nSize;
+        while (nLeft > 0)
+        {
+            ssize_t nWritten = ::write(fd, pData, nLeft);
+            if (nWritten < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            pData += nWritten;
+            nLeft -= static_cast<size_t>(nWritten);
+        }
+        m_nSize = 0; // keeps its capacity for the next batch
+        return true;
+    }
+
+    size_t Pending() const { return m_nSize; }
+
+private:
+    static constexpr size_t kMaxPriceDigits = 11; // up to 99999999.99
+
+    struct Name
+    {
+        const char *pText = nullptr;
+        uint8_t nLength = 0;
+    };
+
+    /* Grows the buffer without zero filling it: Render overwrites every byte it keeps. */
+    void Reserve(size_t nCapacity)
+    {
+        if (nCapacity <= m_nCapacity)
+            return;
+        nCapacity = std::max(nCapacity, 2 * m_nCapacity);
+        std::unique_ptr<char[]> pBuffer(new char[nCapacity]);
+        if (m_nSize)
+            std::memcpy(pBuffer.get(), m_pBuffer.get(), m_nSize);
+        m_pBuffer = std::move(pBuffer);
+        m_nCapacity = nCapacity;
+    }
+
+    Name Intern(std::string_view szName)
+    {
+        m_vNames.emplace_back(szName);
+        return Name{m_vNames.back().data(), static_cast<uint8_t>(szName.size())};
+    }
+
+    /* Writes "<dollars>.<cents>" and returns the end. */
+    char *FormatCents(char *pOut, uint32_t nCents) const
+    {
+        char aDollars[10];
+        char *pDigits = aDollars + sizeof(aDollars);
+        uint32_t nDollars = nCents / 100;
+        while (nDollars >= 100)
+        {
+            pDigits -= 2;
+            std::memcpy(pDigits, &m_aDigitPairs[2 * (nDollars % 100)], 2);
+            nDollars /= 100;
+        }
+        if (nDollars >= 10)
+        {
+            pDigits -= 2;
+            std::memcpy(pDigits, &m_aDigitPairs[2 * nDollars], 2);
+        }
+        else
+            *--pDigits = static_cast<char>('0' + nDollars);
+
+        size_t nLength = static_cast<size_t>(aDollars + sizeof(aDollars) - pDigits);
+        std::memcpy(pOut, pDigits, nLength);
+        pOut += nLength;
+        *pOut++ = '.';
+        std::memcpy(pOut, &m_aDigitPairs[2 * (nCents % 100)], 2);
+        return pOut + 2;
+    }
+
+    std::vector<std::string> m_vNames; // interned text, reserved up front so the pointers stay put
+    std::array<Name, Menu::BaseCount> m_aBase;
+    std::array<Name, Menu::CondimentCount> m_aCondiment;
+    size_t m_nLongestBase = 0;
+    size_t m_nLongestCondiment = 0;
+    char m_aDigitPairs[200];
+    std::unique_ptr<char[]> m_pBuffer;
+    size_t m_nSize = 0;
+    size_t m_nCapacity = 0;
+};
+
+/* Today's way: build the description with + and stream it with the price */
+void RenderWithStreams(const OrderBatch &batch, std::ostream &out)
+{
+    for (size_t order = 0; order < batch.Size(); ++order)
+    {
+        std::string szDescription = std::string(Menu::kBaseNames[batch.Bases()[order]]);
+        double dCost = Menu::kBaseCents[batch.Bases()[order]] / 100.0;
+        for (uint32_t i = batch.Offsets()[order]; i < batch.Offsets()[order + 1]; ++i)
+        {
+            szDescription = szDescription + std::string(Menu::kCondimentNames[batch.Condiments()[i]]);
+            dCost += Menu::kCondimentCents[batch.Condiments()[i]] / 100.0;
+        }
+        out << szDescription << "$" << dCost << "\n";
+    }
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    OrderBatch batch;
+    batch.Add(Menu::Espresso, {});
+    batch.Add(Menu::DarkRoast, {Menu::Mocha, Menu::Milk});
+    batch.Add(Menu::HouseBlend, {Menu::Mocha, Menu::Milk, Menu::Whip});
+
+    ReceiptRenderer renderer;
+    renderer.Render(batch);
+    std::cout.flush();
+    if (!renderer.Flush(STDOUT_FILENO))
+    {
+        std::cerr << "Cannot write receipts: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    /* One batch of nOrders random orders, rendered nBatches times to /dev/null */
+    const size_t nOrders = 100000;
+    const int nBatches = 50;
+    batch = OrderBatch{};
+    uint64_t nState = 0x9e3779b97f4a7c15ull;
+    for (size_t order = 0; order < nOrders; ++order)
+    {
+        nState ^= nState << 13;
+        nState ^= nState >> 7;
+        nState ^= nState << 17;
+        uint8_t aCondiments[5];
+        const size_t nCondiments = (nState >> 8) % 6;
+        for (size_t c = 0; c < nCondiments; ++c)
+            aCondiments[c] = static_cast<uint8_t>((nState >> (16 + 2 * c)) % Menu::CondimentCount);
+        batch.Add(static_cast<uint8_t>(nState % Menu::BaseCount), aCondiments, nCondiments);
+    }
+
+    int fdNull = ::open("/dev/null", O_WRONLY);
+    if (fdNull < 0)
+    {
+        std::cerr << "Cannot open /dev/null: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    size_t nBytes = 0;
+    bool bWritten = true;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < nBatches && bWritten; ++repeat)
+    {
+        renderer.Render(batch);
+        nBytes += renderer.Pending();
+        bWritten = renderer.Flush(fdNull);
+    }
+    double dRendererSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!bWritten)
+        std::cerr << "Cannot write to /dev/null: " << std::strerror(errno) << "\n";
+    ::close(fdNull);
+    if (!bWritten)
+        return 1;
+
+    std::ofstream null("/dev/null");
+    start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < nBatches; ++repeat)
+        RenderWithStreams(batch, null);
+    null.flush();
+    double dStreamSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "=== " << nBatches << " batches of " << nOrders << " receipts, " << nBytes / nBatches / nOrders
+              << " bytes each ===\n";
+    std::cout << "Strings and iostream : " << nBytes / dStreamSeconds / 1e6 << " MB/s\n";
+    std::cout << "Batched renderer     : " << nBytes / dRendererSeconds / 1e6 << " MB/s\n";
+    return 0;
+}
@@ -0,0 +1,286 @@
+/*
+Decorators composed at compile time.
+Most beverages on the menu are fixed combinations, yet decorator_pattern.cpp builds each of them at runtime as a chain
+of std::make_unique allocations and prices it through one virtual call per layer.
+Here a condiment is a class template wrapping the beverage type it decorates, so Milk<Mocha<DarkRoast>> is one
+object with no heap allocation and no virtual call. Cost() is constexpr and the description is concatenated by the
+compiler, so a fixed menu is priced at compile time. Erased<Beverage> puts a static beverage behind the runtime
+Component::Beverages interface, so both kinds can be used side by side.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Component
+{
+    class Beverages
+    {
+    public:
+        virtual ~Beverages() = default;
+        virtual std::string GetDescription() = 0;
+        virtual double Cost() = 0;
+    };
+}
+
+/* A string literal the compiler can concatenate */
+template <size_t N>
+struct FixedString
+{
+    char aText[N + 1] = {};
+
+    constexpr FixedString() = default;
+    constexpr FixedString(const char (&szText)[N + 1])
+    {
+        for (size_t i = 0; i < N; ++i)
+            aText[i] = szText[i];
+    }
+    constexpr std::string_view View() const { return std::string_view(aText, N); }
+};
+
+template <size_t N>
+FixedString(const char (&)[N]) -> FixedString<N - 1>;
+
+template <size_t N, size_t M>
+constexpr FixedString<N + M> operator+(const FixedString<N> &first, const FixedString<M> &second)
+{
+    FixedString<N + M> result;
+    for (size_t i = 0; i < N; ++i)
+        result.aText[i] = first.aText[i];
+    for (size_t i = 0; i < M; ++i)
+        result.aText[N + i] = second.aText[i];
+    return result;
+}
+
+namespace StaticComponents
+{
+    struct HouseBlend
+    {
+        static constexpr FixedString kDescription{"House Blend "};
+        constexpr double Cost() const { return 1.22f; }
+    };
+
+    struct DarkRoast
+    {
+        static constexpr FixedString kDescription{"Dark Roast "};
+        constexpr double Cost() const { return 1.5f; }
+    };
+
+    struct Espresso
+    {
+        static constexpr FixedString kDescription{"Espresso "};
+        constexpr double Cost() const { return 1.5f; }
+    };
+
+    struct Decaf
+    {
+        static constexpr FixedString kDescription{"Decaf "};
+        constexpr double Cost() const { return 1.4f; }
+    };
+}
+
+/* Same text and arithmetic as the runtime decorators, so both forms give identical results */
+namespace StaticDecorators
+{
+    template <typename Beverage>
+    struct Milk
+    {
+        static constexpr auto kDescription = Beverage::kDescription + FixedString{"Milk "};
+        constexpr double Cost() const { return m_vBeverage.Cost() + .6f; }
+        Beverage m_vBeverage;
+    };
+
+    template <typename Beverage>
+    struct Mocha
+    {
+        static constexpr auto kDescription = Beverage::kDescription + FixedString{" Mocha "};
+        constexpr double Cost() const { return 0.5f + m_vBeverage.Cost(); }
+        Beverage m_vBeverage;
+    };
+
+    template <typename Beverage>
+    struct Soy
+    {
+        static constexpr auto kDescription = Beverage::kDescription + FixedString{"Soy "};
+        constexpr double Cost() const { return m_vBeverage.Cost() + .4f; }
+        Beverage m_vBeverage;
+    };
+
+    template <typename Beverage>
+    struct Whip
+    {
+        static constexpr auto kDescription = Beverage::kDescription + FixedString{"Whip "};
+        constexpr double Cost() const { return m_vBeverage.Cost() + .5f; }
+        Beverage m_vBeverage;
+    };
+}
+
+/* Order<DarkRoast, Mocha, Milk> is Milk<Mocha<DarkRoast>>: condiments listed in the order they are added. */
+template <typename Beverage, template <typename> class... Condiments>
+struct OrderOf;
+
+template <typename Beverage>
+struct OrderOf<Beverage>
+{
+    using Type = Beverage;
+};
+
+template <typename Beverage, template <typename> class First, template <typename> class... Rest>
+struct OrderOf<Beverage, First, Rest...>
+{
+    using Type = typename OrderOf<First<Beverage>, Rest...>::Type;
+};
+
+template <typename Beverage, template <typename> class... Condiments>
+using Order = typename OrderOf<Beverage, Condiments...>::Type;
+
+/* Type erasure: a static beverage behind the runtime interface */
+template <typename Beverage>
+class Erased : public Component::Beverages
+{
+public:
+    std::string GetDescription() override { return std::string(Beverage::kDescription.View()); }
+    double Cost() override { return m_Beverage.Cost(); }
+
+private:
+    Beverage m_Beverage;
+};
+
+template <typename Beverage>
+std::unique_ptr<Component::Beverages> MakeErased() { return std::make_unique<Erased<Beverage>>(); }
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* The runtime decorator chain from decorator_pattern.cpp, for the benchmark */
+namespace ConcreteComponents
+{
+    class DarkRoast : public Component::Beverages
+    {
+    public:
+        std::string GetDescription() override { return "Dark Roast "; }
+        double Cost() override { return 1.5f; }
+    };
+}
+
+namespace ConcreteDecorators
+{
+    class Milk : public Component::Beverages
+    {
+    public:
+        Milk(std::unique_ptr<Component::Beverages> beverage) : m_vBeverage(std::move(beverage)) {}
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + "Milk "; }
+        double Cost() override { return m_vBeverage->Cost() + .6f; }
+
+    private:
+        std::unique_ptr<Component::Beverages> m_vBeverage;
+    };
+
+    class Mocha : public Component::Beverages
+    {
+    public:
+        Mocha(std::unique_ptr<Component::Beverages> beverage) : m_vBeverage(std::move(beverage)) {}
+        std::string GetDescription() override { return m_vBeverage->GetDescription() + " Mocha "; }
+        double Cost() override { return 0.5f + m_vBeverage->Cost(); }
+
+    private:
+        std::unique_ptr<Component::Beverages> m_vBeverage;
+    };
+}
+
+namespace Benchmark
+{
+    /* Makes the compiler treat value as read and changed here, so the static loop, whose every cost is a
+       compile-time constant, is not folded into one multiplication. */
+    template <typename T>
+    inline void DoNotOptimize(T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : "+m"(value) : : "memory");
+#else
+        volatile T copy = value;
+        value = copy;
+#endif
+    }
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main(int argc, char **argv)
+{
+    using namespace StaticComponents;
+    using namespace StaticDecorators;
+
+    /* Priced by the compiler */
+    using DarkMochaMilk = Order<DarkRoast, Mocha, Milk>;
+    using HouseSpecial = Order<HouseBlend, Mocha, Milk, Whip>;
+    constexpr double kDarkMochaMilk = DarkMochaMilk{}.Cost();
+    constexpr double kHouseSpecial = HouseSpecial{}.Cost();
+    static_assert(sizeof(HouseSpecial) == 1, "a static beverage holds no data");
+    static_assert(DarkMochaMilk::kDescription.View() == "Dark Roast  Mocha Milk ", "description built at compile time");
+
+    std::cout << Espresso::kDescription.View() << "$" << Espresso{}.Cost() << "\n";
+    std::cout << DarkMochaMilk::kDescription.View() << "$" << kDarkMochaMilk << "\n";
+    std::cout << HouseSpecial::kDescription.View() << "$" << kHouseSpecial << "\n";
+
+    /* Static and runtime beverages in one list */
+    std::vector<std::unique_ptr<Component::Beverages>> vMenu;
+    vMenu.push_back(MakeErased<Order<Decaf, Soy, Whip>>());
+    vMenu.push_back(std::make_unique<ConcreteDecorators::Milk>(
+        std::make_unique<ConcreteDecorators::Mocha>(std::make_unique<ConcreteComponents::DarkRoast>())));
+    for (auto &beverage : vMenu)
+        std::cout << beverage->GetDescription() << "$" << beverage->Cost() << "\n";
+
+    /* Building and pricing a Dark Roast with Mocha and Milk, nOrders times; the count is read at run time */
+    const int nOrders = argc > 1 ? std::stoi(argv[1]) : 5000000;
+    using Clock = std::chrono::steady_clock;
+    double dChainTotal = 0.0, dStaticTotal = 0.0, dErasedTotal = 0.0;
+    size_t nChainLength = 0, nStaticLength = 0;
+
+    auto start = Clock::now();
+    for (int order = 0; order < nOrders; ++order)
+    {
+        std::unique_ptr<Component::Beverages> beverage = std::make_unique<ConcreteComponents::DarkRoast>();
+        beverage = std::make_unique<ConcreteDecorators::Mocha>(std::move(beverage));
+        beverage = std::make_unique<ConcreteDecorators::Milk>(std::move(beverage));
+        double dCost = beverage->Cost();
+        size_t nLength = beverage->GetDescription().size();
+        Benchmark::DoNotOptimize(dCost);
+        Benchmark::DoNotOptimize(nLength);
+        dChainTotal += dCost;
+        nChainLength += nLength;
+    }
+    double dChainNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / nOrders;
+
+    start = Clock::now();
+    for (int order = 0; order < nOrders; ++order)
+    {
+        DarkMochaMilk beverage;
+        double dCost = beverage.Cost();
+        size_t nLength = DarkMochaMilk::kDescription.View().size();
+        Benchmark::DoNotOptimize(dCost);
+        Benchmark::DoNotOptimize(nLength);
+        dStaticTotal += dCost;
+        nStaticLength += nLength;
+    }
+    double dStaticNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / nOrders;
+
+    /* Erased pays one allocation and one virtual call per order, but no per-layer work */
+    start = Clock::now();
+    for (int order = 0; order < nOrders; ++order)
+    {
+        double dCost = MakeErased<DarkMochaMilk>()->Cost();
+        Benchmark::DoNotOptimize(dCost);
+        dErasedTotal += dCost;
+    }
+    double dErasedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / nOrders;
+
+    std::cout << "=== " << nOrders << " Dark Roast Mocha Milk orders ===\n";
+    std::cout << "make_unique chain : " << dChainNs << " ns/order\n";
+    std::cout << "Static decorators : " << dStaticNs << " ns/order\n";
+    std::cout << "Erased static     : " << dErasedNs << " ns/order (cost only)\n";
+    bool bSame = dChainTotal == dStaticTotal && dStaticTotal == dErasedTotal && nChainLength == nStaticLength;
+    std::cout << "Same totals: " << (bSame ? "yes" : "no") << "\n";
+    return bSame ? 0 : 1;
+}
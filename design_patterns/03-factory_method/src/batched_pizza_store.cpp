@@ -0,0 +1,169 @@
+/*
+ * Batched ordering.
+ * A caller placing a bulk order calls OrderPizza once per pizza, and every call pays for a virtual CreatePizza, a
+ * registry lookup and a null check before the four stages run.
+ * BatchedPizzaStore adds OrderPizzas to a registered store: it takes a whole list of types, resolves every type to
+ * its registry slot first and groups the orders by slot through a table indexed by it. Each group goes to the batch
+ * factory registered with its pizza, which makes the pizzas and runs each stage over the whole group with direct calls
+ * to that kind's stages, all writing into one buffer that is reused between batches and written out once per batch.
+ * The pizzas come back in the order they were asked for, with null for each rejected type.
+ * The products and stores are those of factory_method.cpp, from pizza_store.h.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pizza_store.h"
+
+namespace Batch
+{
+    template <typename Store>
+    class BatchedPizzaStore : public Store
+    {
+    public:
+        /*
+         * Orders pTypes[0 .. nTypes) at once. The result has one pizza per order, in order, with null for the types
+         * the store does not make. The same lines are written as by OrderPizza for each type, but grouped by pizza
+         * type and stage rather than in order.
+         */
+        std::vector<Product::PizzaHandle> OrderPizzas(const std::string_view *pTypes, size_t nTypes,
+                                                      std::ostream &out = std::cout)
+        {
+            const Creator::ProductRegistry &registry = Store::Registry();
+            m_vGroupOfSlot.assign(registry.SlotCount(), kNoGroup);
+            size_t nGroups = 0;
+            for (size_t order = 0; order < nTypes; ++order)
+            {
+                size_t nSlot = registry.Index(pTypes[order]);
+                if (nSlot == Creator::ProductRegistry::kNone)
+                {
+                    m_Text << "Sorry, we don't make that type of pizza.\n";
+                    continue;
+                }
+                size_t &nGroup = m_vGroupOfSlot[nSlot];
+                if (nGroup == kNoGroup)
+                {
+                    nGroup = nGroups++;
+                    if (m_vGroups.size() < nGroups)
+                        m_vGroups.emplace_back();
+                    m_vGroups[nGroup].nSlot = nSlot;
+                    m_vGroups[nGroup].vOrders.clear(); // keeps the capacity of earlier batches
+                }
+                m_vGroups[nGroup].vOrders.push_back(order);
+            }
+
+            std::vector<Product::PizzaHandle> vPizzas(nTypes);
+            for (size_t group = 0; group < nGroups; ++group)
+                registry.BatchAt(m_vGroups[group].nSlot)(m_vGroups[group].vOrders, vPizzas.data(), m_Text);
+            out.write(m_Text.Data(), static_cast<std::streamsize>(m_Text.Size()));
+            m_Text.Clear();
+            return vPizzas;
+        }
+
+        std::vector<Product::PizzaHandle> OrderPizzas(const std::vector<std::string_view> &vTypes,
+                                                      std::ostream &out = std::cout)
+        {
+            return OrderPizzas(vTypes.data(), vTypes.size(), out);
+        }
+
+    private:
+        static constexpr size_t kNoGroup = SIZE_MAX;
+
+        struct Group
+        {
+            size_t nSlot = 0;
+            std::vector<size_t> vOrders;
+        };
+
+        /* Reused from batch to batch, so a batch allocates only the vector of pizzas it returns */
+        std::vector<size_t> m_vGroupOfSlot;
+        std::vector<Group> m_vGroups;
+        Product::TextBuffer m_Text;
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* The lines of szText, sorted, so that output written in a different order can be compared */
+std::vector<std::string> SortedLines(const std::string &szText)
+{
+    std::vector<std::string> vLines;
+    std::istringstream in(szText);
+    for (std::string szLine; std::getline(in, szLine);)
+        vLines.push_back(szLine);
+    std::sort(vLines.begin(), vLines.end());
+    return vLines;
+}
+
+int main()
+{
+    Batch::BatchedPizzaStore<ConcreteCreator::NYPizzaStore> nyPizzaStore;
+
+    std::vector<Product::PizzaHandle> vOrder = nyPizzaStore.OrderPizzas({"cheese", "pepperoni", "clam", "cheese"});
+    for (auto &pizza : vOrder)
+        std::cout << (pizza ? pizza->GetName() : "(not on the menu)") << "\n";
+    std::cout << " ------------------------------------------- \n";
+
+    /* nOrders orders drawn from the menu, with an item the store does not make now and then, placed in batches */
+    const size_t nOrders = 1000000;
+    const size_t nBatch = 1000;
+    const std::string_view aMenu[] = {"cheese", "clam", "veggie", "cheese", "clam", "veggie", "cheese", "pepperoni"};
+    std::vector<std::string_view> vItems;
+    vItems.reserve(nOrders);
+    for (size_t order = 0; order < nOrders; ++order)
+        vItems.push_back(aMenu[(order * 2654435761u >> 16) % 8]);
+    using Clock = std::chrono::steady_clock;
+
+    /* The first batches are written out in full: both ways must produce the same lines */
+    const size_t nChecked = 10 * nBatch;
+    std::ostringstream loopText, batchText;
+    bool bSamePizzas = true;
+    for (size_t first = 0; first < nChecked; first += nBatch)
+    {
+        std::vector<Product::PizzaHandle> vPizzas = nyPizzaStore.OrderPizzas(&vItems[first], nBatch, batchText);
+        for (size_t i = 0; i < nBatch; ++i)
+        {
+            Product::PizzaHandle pizza = nyPizzaStore.OrderPizza(vItems[first + i], loopText);
+            bSamePizzas = bSamePizzas && (pizza ? vPizzas[i] && vPizzas[i]->GetName() == pizza->GetName() : !vPizzas[i]);
+        }
+    }
+    bool bSameLines = SortedLines(loopText.str()) == SortedLines(batchText.str());
+
+    DiscardBuffer buffer;
+    std::ostream out(&buffer);
+    size_t nLoopMade = 0;
+    auto start = Clock::now();
+    for (std::string_view item : vItems)
+        nLoopMade += nyPizzaStore.OrderPizza(item, out) != nullptr;
+    double dLoopSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    size_t nBatchMade = 0;
+    bool bInOrder = true;
+    start = Clock::now();
+    for (size_t first = 0; first < nOrders; first += nBatch)
+    {
+        size_t nCount = std::min(nBatch, nOrders - first);
+        std::vector<Product::PizzaHandle> vPizzas = nyPizzaStore.OrderPizzas(&vItems[first], nCount, out);
+        for (size_t i = 0; i < nCount; ++i)
+        {
+            nBatchMade += vPizzas[i] != nullptr;
+            bInOrder = bInOrder && (vPizzas[i] == nullptr) == (vItems[first + i] == "pepperoni");
+        }
+    }
+    double dBatchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "=== " << nOrders << " orders ===\n";
+    std::cout << "OrderPizza in a loop         : " << nOrders / dLoopSeconds / 1e6 << " M orders/s\n";
+    std::cout << "OrderPizzas, batches of " << nBatch << " : " << nOrders / dBatchSeconds / 1e6 << " M orders/s\n";
+    std::cout << "Batched speedup              : " << dLoopSeconds / dBatchSeconds << "x\n";
+    bool bSame = nLoopMade == nBatchMade && bInOrder && bSamePizzas && bSameLines;
+    std::cout << "Same pizzas in order, and the same lines for the first " << nChecked << " orders: "
+              << (bSame ? "yes" : "no") << "\n";
+    return bSame ? 0 : 1;
+}
@@ -5,169 +5,35 @@
  * object creation by letting subclasses decide what objects to create.
  */
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
-#include <vector>
-#include <string>
-#include <memory>
+#include <new>
 
-namespace Product
-{
-    class Pizza
-    {
-    public:
-        virtual void Prepare()
-        {
-            std::cout << "Preparing " << m_szName << "\n";
-            std::cout << "Tossing Dough \n";
-            std::cout << "Adding Sauce \n";
-            std::cout << "Adding Toppings: \n";
-            for (auto topping : m_vToppings)
-            {
-                std::cout << "* " << topping << "\n";
-            }
-        }
-        virtual void Bake()
-        {
-            std::cout << "Bake for 25 min at 175 degree \n";
-        }
-        virtual void Cut()
-        {
-            std::cout << "Cut in Diagonal slices \n";
-        }
-        virtual void Box()
-        {
-            std::cout << "Place pizza in official PizzaStore box \n";
-        }
-        virtual std::string GetName() { return m_szName; };
-
-    protected:
-        std::string m_szName;
-        std::string m_szDough;
-        std::string m_szSauce;
-        std::vector<std::string> m_vToppings;
-    };
-}
-
-namespace ConcreteProduct
-{
-    class NYStyleCheesePizza : public Product::Pizza
-    {
-    public:
-        NYStyleCheesePizza()
-        {
-            m_szName = "Ny Style Cheese Pizza";
-            m_szDough = "Thin Crust Dough";
-            m_szSauce = "Marinara Sauce";
-
-            m_vToppings.emplace_back("Grated Reggiano Cheese");
-            m_vToppings.emplace_back("Shredded Mozzarella Cheese");
-        }
-    };
-
-    class NYStyleClamPizza : public Product::Pizza
-    {
-    public:
-        NYStyleClamPizza()
-        {
-            m_szName = "Ny Style Clam, Pizza";
-            m_szDough = "Thin Crust Dough";
-            m_szSauce = "Marinara Sauce";
-
-            m_vToppings.emplace_back("Grated Reggiano Cheese");
-            m_vToppings.emplace_back("Shredded Mozzarella Cheese");
-        }
-    };
-    class NYStyleVeggiePizza : public Product::Pizza
-    {
-    public:
-        NYStyleVeggiePizza()
-        {
-            m_szName = "Ny Style Veggie, Pizza";
-            m_szDough = "Thin Crust Dough";
-            m_szSauce = "Marinara Sauce";
-
-            m_vToppings.emplace_back("Basil, Olive Oil");
-            m_vToppings.emplace_back("Mushroom & Jalapeno");
-            m_vToppings.emplace_back("Shredded Mozzarella Cheese");
-        }
-    };
-
-    class ChicagoStyleVeggiePizza : public Product::Pizza
-    {
-    public:
-        ChicagoStyleVeggiePizza()
-        {
-            m_szName = "Ny Style Veggie, Pizza";
-            m_szDough = "Thin Crust Dough";
-            m_szSauce = "Marinara Sauce";
+#include "pizza_store.h"
 
-            m_vToppings.emplace_back("Basil, Olive Oil");
-            m_vToppings.emplace_back("Shredded Mozzarella Cheese");
-        }
-    };
-}
+/* Counts every heap allocation, to check that ordering a pizza makes none once the pools are warm */
+static std::atomic<uint64_t> g_nAllocations{0};
 
-namespace Creator
+void *operator new(std::size_t nSize)
 {
-    class PizzaStore
-    {
-    public:
-        virtual std::unique_ptr<Product::Pizza> CreatePizza(std::string item) = 0;
-        virtual std::unique_ptr<Product::Pizza> OrderPizza(std::string type)
-        {
-            auto pizza = CreatePizza(type);
-            if (pizza == nullptr)
-            {
-                std::cout << "Sorry, we don't make that type of pizza.\n";
-                return nullptr;
-            }
-            pizza->Prepare();
-            pizza->Bake();
-            pizza->Cut();
-            pizza->Box();
-
-            return pizza;
-        }
-    };
+    g_nAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pMemory = std::malloc(nSize ? nSize : 1))
+        return pMemory;
+    throw std::bad_alloc();
 }
 
-namespace ConcreteCreator
-{
-    class NYPizzaStore : public Creator::PizzaStore
-    {
-    protected:
-        std::unique_ptr<Product::Pizza> CreatePizza(std::string item) override
-        {
-            if (item.compare("cheese") == 0)
-            {
-                return std::make_unique<ConcreteProduct::NYStyleCheesePizza>();
-            }
-            else if (item.compare("clam") == 0)
-            {
-                return std::make_unique<ConcreteProduct::NYStyleClamPizza>();
-            }
-            else if (item.compare("veggie") == 0)
-            {
-                return std::make_unique<ConcreteProduct::NYStyleVeggiePizza>();
-            }
-            else
-                return nullptr;
-        }
-    };
-    class ChicagoPizzaStore : public Creator::PizzaStore
-    {
-    protected:
-        std::unique_ptr<Product::Pizza> CreatePizza(std::string item) override
-        {
-            if (item.compare("veggie") == 0)
-            {
-                return std::make_unique<ConcreteProduct::ChicagoStyleVeggiePizza>();
-            }
-            else
-                return nullptr;
-        }
-    };
-}
+/* GCC pairs these frees with its own operator new rather than the one above and warns wherever it inlines them */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *pMemory) noexcept { std::free(pMemory); }
+void operator delete(void *pMemory, std::size_t) noexcept { std::free(pMemory); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
 
 /*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
 int main()
@@ -175,20 +41,40 @@ int main()
     std::unique_ptr<Creator::PizzaStore> nyPizzaStore = std::make_unique<ConcreteCreator::NYPizzaStore>();
     std::unique_ptr<Creator::PizzaStore> chicagoPizzaStore = std::make_unique<ConcreteCreator::ChicagoPizzaStore>();
 
-    std::unique_ptr<Product::Pizza> pizza = nyPizzaStore->OrderPizza("cheese");
+    Product::PizzaHandle pizza = nyPizzaStore->OrderPizza("cheese");
     std::cout << "Ethan's order " << pizza->GetName() << "is ready \n";
     std::cout << " ------------------------------------------- \n";
 
-    std::unique_ptr<Product::Pizza> pizza1 = chicagoPizzaStore->OrderPizza("veggie");
+    Product::PizzaHandle pizza1 = chicagoPizzaStore->OrderPizza("veggie");
     std::cout << "John's order " << pizza1->GetName() << "is ready \n";
     std::cout << " ------------------------------------------- \n";
 
-    std::unique_ptr<Product::Pizza> pizza2 = chicagoPizzaStore->OrderPizza("cheese");
+    Product::PizzaHandle pizza2 = chicagoPizzaStore->OrderPizza("cheese");
     if (pizza2 != nullptr)
         std::cout << "Ethan's order " << pizza2->GetName() << "is ready \n";
     else
         std::cout << "We don't have this pizza type!!! \n";
     std::cout << " ------------------------------------------- \n";
 
-    return 0;
+    /* Every kind has been ordered once above or here, so from now on each order reuses a pooled pizza */
+    const char *aOrders[][2] = {{"ny", "cheese"}, {"ny", "clam"}, {"ny", "veggie"}, {"chicago", "veggie"}, {"chicago", "cheese"}};
+    DiscardBuffer buffer;
+    std::ostream out(&buffer);
+    auto order = [&](const char *aOrder[2])
+    {
+        Creator::PizzaStore &store = aOrder[0][0] == 'n' ? *nyPizzaStore : *chicagoPizzaStore;
+        return store.OrderPizza(aOrder[1], out) != nullptr;
+    };
+    for (auto &aOrder : aOrders)
+        order(aOrder);
+
+    const int nOrders = 100000;
+    uint64_t nBefore = g_nAllocations.load(std::memory_order_relaxed);
+    int nMade = 0;
+    for (int i = 0; i < nOrders; ++i)
+        nMade += order(aOrders[i % 5]);
+    uint64_t nAllocations = g_nAllocations.load(std::memory_order_relaxed) - nBefore;
+
+    std::cout << nMade << " of " << nOrders << " orders made with " << nAllocations << " heap allocations\n";
+    return nAllocations == 0 ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,321 @@
+/*
+ * Pipelined order processing.
+ * PizzaStore::OrderPizza in factory_method.cpp runs Prepare, Bake, Cut and Box one after another on the thread that
+ * takes the order. OrderPipeline gives every stage its own workers, as many per stage as configured, and connects the
+ * stages with bounded lock free queues: a stage that falls behind fills its input queue, and the stage before it
+ * waits, so work in flight is capped by the queue sizes.
+ * The thread calling Run is the source: it makes each pizza with the store's CreatePizza, exactly as OrderPizza does,
+ * and receives finished pizzas back from the last stage. Pizzas therefore return to the source thread's pool and
+ * the source sees each order's latency. The products and stores are those of factory_method.cpp, from
+ * pizza_store.h; each worker passes the stages its own stream.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "pizza_store.h"
+
+namespace Pipeline
+{
+    using Clock = std::chrono::steady_clock;
+
+    /*
+     * Bounded multi producer, multi consumer queue (Vyukov). Every cell holds a sequence number telling whether it
+     * is free to write or ready to read in the current lap, so a push or pop is one compare and swap on its own
+     * index and never takes a lock. TryPush and TryPop fail instead of waiting when the queue is full or empty.
+     */
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t nCapacity) // rounded up to a power of two
+        {
+            size_t nSize = 2;
+            while (nSize < nCapacity)
+                nSize *= 2;
+            m_pCells = std::make_unique<Cell[]>(nSize);
+            for (size_t i = 0; i < nSize; ++i)
+                m_pCells[i].nSequence.store(i, std::memory_order_relaxed);
+            m_nMask = nSize - 1;
+        }
+
+        /* Moves from value only when it succeeds. */
+        bool TryPush(T &value)
+        {
+            size_t nPos = m_nTail.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = m_pCells[nPos & m_nMask];
+                size_t nSequence = cell.nSequence.load(std::memory_order_acquire);
+                intptr_t nLap = static_cast<intptr_t>(nSequence) - static_cast<intptr_t>(nPos);
+                if (nLap == 0)
+                {
+                    if (m_nTail.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                    {
+                        cell.value = std::move(value);
+                        cell.nSequence.store(nPos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (nLap < 0)
+                    return false;
+                else
+                    nPos = m_nTail.load(std::memory_order_relaxed);
+            }
+        }
+
+        bool TryPop(T &value)
+        {
+            size_t nPos = m_nHead.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell &cell = m_pCells[nPos & m_nMask];
+                size_t nSequence = cell.nSequence.load(std::memory_order_acquire);
+                intptr_t nLap = static_cast<intptr_t>(nSequence) - static_cast<intptr_t>(nPos + 1);
+                if (nLap == 0)
+                {
+                    if (m_nHead.compare_exchange_weak(nPos, nPos + 1, std::memory_order_relaxed))
+                    {
+                        value = std::move(cell.value);
+                        cell.nSequence.store(nPos + m_nMask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (nLap < 0)
+                    return false;
+                else
+                    nPos = m_nHead.load(std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> nSequence{0};
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> m_pCells;
+        size_t m_nMask = 0;
+        alignas(64) std::atomic<size_t> m_nTail{0};
+        alignas(64) std::atomic<size_t> m_nHead{0};
+    };
+
+    enum Stage
+    {
+        Prepare,
+        Bake,
+        Cut,
+        Box,
+        StageCount
+    };
+
+    struct Config
+    {
+        std::array<int, StageCount> aWorkers{1, 1, 1, 1};
+        size_t nQueueCapacity = 256; // per queue
+    };
+
+    /* One order in flight */
+    struct Ticket
+    {
+        Product::PizzaHandle pizza;
+        Clock::time_point tOrdered;
+    };
+
+    struct Report
+    {
+        size_t nRejected = 0;
+        std::vector<double> vLatencyNs; // one per finished order, in the order they finished
+    };
+
+    class OrderPipeline
+    {
+    public:
+        explicit OrderPipeline(const Config &config)
+        {
+            for (int queue = 0; queue <= StageCount; ++queue) // stage inputs, then finished pizzas
+                m_vQueues.push_back(std::make_unique<BoundedQueue<Ticket>>(config.nQueueCapacity));
+            for (int stage = 0; stage < StageCount; ++stage)
+                for (int worker = 0; worker < config.aWorkers[stage]; ++worker)
+                    m_vWorkers.emplace_back(&OrderPipeline::Work, this, static_cast<Stage>(stage));
+        }
+
+        ~OrderPipeline()
+        {
+            m_bStop.store(true, std::memory_order_relaxed);
+            for (auto &worker : m_vWorkers)
+                worker.join();
+        }
+
+        OrderPipeline(const OrderPipeline &) = delete;
+        OrderPipeline &operator=(const OrderPipeline &) = delete;
+
+        /* Orders every item from store and returns once all of them are boxed. Call from one thread at a time. */
+        Report Run(Creator::PizzaStore &store, const std::vector<std::string_view> &vItems)
+        {
+            Report report;
+            report.vLatencyNs.reserve(vItems.size());
+            BoundedQueue<Ticket> &orders = *m_vQueues.front();
+            BoundedQueue<Ticket> &finished = *m_vQueues.back();
+
+            size_t nNext = 0, nSent = 0;
+            Ticket ticket, done;
+            while (nNext < vItems.size() || ticket.pizza || report.vLatencyNs.size() < nSent)
+            {
+                bool bProgress = false;
+                while (finished.TryPop(done))
+                {
+                    report.vLatencyNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - done.tOrdered).count());
+                    done.pizza.reset(); // back to this thread's pool
+                    bProgress = true;
+                }
+
+                if (!ticket.pizza && nNext < vItems.size())
+                {
+                    ticket.tOrdered = Clock::now();
+                    ticket.pizza = store.CreatePizza(vItems[nNext++]);
+                    if (!ticket.pizza)
+                        ++report.nRejected;
+                    bProgress = true;
+                }
+                if (ticket.pizza && orders.TryPush(ticket))
+                {
+                    ++nSent;
+                    bProgress = true;
+                }
+
+                if (!bProgress)
+                    std::this_thread::yield();
+            }
+            return report;
+        }
+
+    private:
+        void Work(Stage eStage)
+        {
+            DiscardBuffer buffer;
+            std::ostream out(&buffer);
+            BoundedQueue<Ticket> &input = *m_vQueues[eStage];
+            BoundedQueue<Ticket> &output = *m_vQueues[eStage + 1];
+
+            Ticket ticket;
+            while (!m_bStop.load(std::memory_order_relaxed))
+            {
+                if (!input.TryPop(ticket))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                switch (eStage)
+                {
+                case Prepare:
+                    ticket.pizza->Prepare(out);
+                    break;
+                case Bake:
+                    ticket.pizza->Bake(out);
+                    break;
+                case Cut:
+                    ticket.pizza->Cut(out);
+                    break;
+                default:
+                    ticket.pizza->Box(out);
+                    break;
+                }
+
+                while (!output.TryPush(ticket)) // the next stage is full: wait for it
+                {
+                    if (m_bStop.load(std::memory_order_relaxed))
+                        return;
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<BoundedQueue<Ticket>>> m_vQueues;
+        std::vector<std::thread> m_vWorkers;
+        std::atomic<bool> m_bStop{false};
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+double Percentile(std::vector<double> vValues, double dFraction)
+{
+    if (vValues.empty())
+        return 0.0;
+    size_t nIndex = static_cast<size_t>(dFraction * (vValues.size() - 1));
+    std::nth_element(vValues.begin(), vValues.begin() + nIndex, vValues.end());
+    return vValues[nIndex];
+}
+
+void PrintResult(const char *szName, size_t nOrders, double dSeconds, const std::vector<double> &vLatencyNs)
+{
+    std::cout << szName << nOrders / dSeconds / 1e6 << " M orders/s, latency p50 " << Percentile(vLatencyNs, 0.5) / 1e3
+              << " us, p99 " << Percentile(vLatencyNs, 0.99) / 1e3 << " us\n";
+}
+
+int main()
+{
+    ConcreteCreator::NYPizzaStore nyPizzaStore;
+
+    /* nOrders orders drawn from the menu, with an item the store does not make now and then */
+    const size_t nOrders = 200000;
+    const std::string_view aMenu[] = {"cheese", "clam", "veggie", "cheese", "clam", "veggie", "cheese", "pepperoni"};
+    std::vector<std::string_view> vItems;
+    vItems.reserve(nOrders);
+    for (size_t order = 0; order < nOrders; ++order)
+        vItems.push_back(aMenu[(order * 2654435761u >> 16) % 8]);
+    size_t nExpected = static_cast<size_t>(std::count_if(vItems.begin(), vItems.end(), [](std::string_view item)
+                                                         { return item != "pepperoni"; }));
+    using Clock = Pipeline::Clock;
+
+    /* Today's way: every stage on the ordering thread */
+    DiscardBuffer buffer;
+    std::ostream out(&buffer);
+    std::vector<double> vSerialNs;
+    vSerialNs.reserve(nOrders);
+    Creator::PizzaStore &store = nyPizzaStore;
+    auto start = Clock::now();
+    for (std::string_view item : vItems)
+    {
+        auto tOrdered = Clock::now();
+        Product::PizzaHandle pizza = store.CreatePizza(item);
+        if (!pizza)
+            continue;
+        pizza->Prepare(out);
+        pizza->Bake(out);
+        pizza->Cut(out);
+        pizza->Box(out);
+        vSerialNs.push_back(std::chrono::duration<double, std::nano>(Clock::now() - tOrdered).count());
+    }
+    double dSerialSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "=== " << nOrders << " orders, " << std::thread::hardware_concurrency() << " hardware threads ===\n";
+    PrintResult("One thread              : ", vSerialNs.size(), dSerialSeconds, vSerialNs);
+
+    bool bAllDone = vSerialNs.size() == nExpected;
+    const Pipeline::Config aConfigs[] = {{{1, 1, 1, 1}, 256}, {{1, 2, 2, 1}, 256}, {{2, 2, 2, 2}, 64}};
+    for (const Pipeline::Config &config : aConfigs)
+    {
+        Pipeline::OrderPipeline pipeline(config);
+        start = Clock::now();
+        Pipeline::Report report = pipeline.Run(nyPizzaStore, vItems);
+        double dSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << "Pipeline " << config.aWorkers[0] << "-" << config.aWorkers[1] << "-" << config.aWorkers[2] << "-"
+                  << config.aWorkers[3] << ", queues of " << config.nQueueCapacity << " : ";
+        PrintResult("", report.vLatencyNs.size(), dSeconds, report.vLatencyNs);
+        bAllDone = bAllDone && report.vLatencyNs.size() == nExpected && report.nRejected == nOrders - nExpected;
+    }
+    std::cout << "Every order finished: " << (bAllDone ? "yes" : "no") << "\n";
+    return bAllDone ? 0 : 1;
+}
@@ -0,0 +1,470 @@
+/*
+ * The products and stores of factory_method.cpp, shared by the programs in this directory that order pizzas from
+ * them. The stages and OrderPizza write to std::cout unless they are given another stream.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* A stream buffer that drops what is written to it, for timing the stages without the cost of a real stream. */
+class DiscardBuffer : public std::streambuf
+{
+public:
+    DiscardBuffer() { setp(m_aBuffer, m_aBuffer + sizeof(m_aBuffer)); }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        setp(m_aBuffer, m_aBuffer + sizeof(m_aBuffer));
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+
+private:
+    char m_aBuffer[256];
+};
+
+namespace Product
+{
+    /* Ingredient names are interned once; recipes refer to them by id. */
+    using IngredientId = uint16_t;
+
+    class Ingredients
+    {
+    public:
+        /* Called while recipes are defined, at program start, never while orders are taken. */
+        static IngredientId Intern(std::string_view szName)
+        {
+            auto &names = Names();
+            for (size_t id = 0; id < names.size(); ++id)
+                if (names[id] == szName)
+                    return static_cast<IngredientId>(id);
+            names.emplace_back(szName);
+            return static_cast<IngredientId>(names.size() - 1);
+        }
+        static std::string_view Name(IngredientId id) { return Names()[id]; }
+
+    private:
+        static std::deque<std::string> &Names() // a deque never moves its elements, so names stay put
+        {
+            static std::deque<std::string> names;
+            return names;
+        }
+    };
+
+    /*
+     * Text appended to one reused buffer: what the batched stages write to instead of a stream. An append is a
+     * capacity check and a memcpy, std::string::append is several times slower for lines this short.
+     */
+    class TextBuffer
+    {
+    public:
+        TextBuffer &operator<<(std::string_view szText)
+        {
+            if (szText.size() > m_nCapacity - m_nSize)
+                Grow(m_nSize + szText.size());
+            std::memcpy(m_pText.get() + m_nSize, szText.data(), szText.size());
+            m_nSize += szText.size();
+            return *this;
+        }
+        const char *Data() const { return m_pText.get(); }
+        size_t Size() const { return m_nSize; }
+        void Clear() { m_nSize = 0; } // keeps the capacity for the next batch
+
+    private:
+        /* Grows without zero filling: only the first m_nSize bytes are ever read. */
+        void Grow(size_t nCapacity)
+        {
+            nCapacity = std::max(nCapacity, 2 * m_nCapacity);
+            std::unique_ptr<char[]> pText(new char[nCapacity]);
+            if (m_nSize)
+                std::memcpy(pText.get(), m_pText.get(), m_nSize);
+            m_pText = std::move(pText);
+            m_nCapacity = nCapacity;
+        }
+
+        std::unique_ptr<char[]> m_pText;
+        size_t m_nSize = 0;
+        size_t m_nCapacity = 0;
+    };
+
+    /* What one kind of pizza is made of. A single immutable instance per kind, shared by all its pizzas. */
+    struct Recipe
+    {
+        Recipe(std::string_view name, std::string_view dough, std::string_view sauce,
+               std::initializer_list<std::string_view> toppings)
+            : szName(name), nDough(Ingredients::Intern(dough)), nSauce(Ingredients::Intern(sauce))
+        {
+            for (std::string_view topping : toppings)
+                vToppings.push_back(Ingredients::Intern(topping));
+        }
+
+        std::string szName;
+        IngredientId nDough;
+        IngredientId nSauce;
+        std::vector<IngredientId> vToppings;
+    };
+
+    class Pizza
+    {
+    public:
+        virtual ~Pizza() = default;
+        virtual void Prepare(std::ostream &out = std::cout) { PrepareTo(out); }
+        virtual void Bake(std::ostream &out = std::cout) { BakeTo(out); }
+        virtual void Cut(std::ostream &out = std::cout) { CutTo(out); }
+        virtual void Box(std::ostream &out = std::cout) { BoxTo(out); }
+        virtual std::string_view GetName() { return m_pRecipe->szName; };
+
+        /*
+         * The stages, written to any Sink with operator<< for text. A kind that changes a stage overrides the virtual
+         * and hides the template with its own, so Kind::PrepareTo is always that kind's stage and can be called directly.
+         */
+        template <typename Sink>
+        void PrepareTo(Sink &out) const
+        {
+            out << "Preparing " << std::string_view(m_pRecipe->szName) << "\n";
+            out << "Tossing Dough \n";
+            out << "Adding Sauce \n";
+            out << "Adding Toppings: \n";
+            for (IngredientId topping : m_pRecipe->vToppings)
+            {
+                out << "* " << Ingredients::Name(topping) << "\n";
+            }
+        }
+        template <typename Sink>
+        void BakeTo(Sink &out) const
+        {
+            out << "Bake for 25 min at 175 degree \n";
+        }
+        template <typename Sink>
+        void CutTo(Sink &out) const
+        {
+            out << "Cut in Diagonal slices \n";
+        }
+        template <typename Sink>
+        void BoxTo(Sink &out) const
+        {
+            out << "Place pizza in official PizzaStore box \n";
+        }
+
+    protected:
+        explicit Pizza(const Recipe &recipe) : m_pRecipe(&recipe) {}
+
+        const Recipe *m_pRecipe;
+    };
+
+    /* Deleter that hands a pizza back to the pool it came from. */
+    struct Recycle
+    {
+        void (*pRelease)(Pizza *) = nullptr;
+        void operator()(Pizza *pPizza) const { pRelease(pPizza); }
+    };
+
+    using PizzaHandle = std::unique_ptr<Pizza, Recycle>;
+
+    /*
+     * Per thread free list of pizzas of one kind. A pizza only points at its recipe, so it is reused as it is.
+     * A pizza released after its thread's list has been destroyed (a handle held by a thread_local or static object
+     * that outlives it) is deleted instead of being pushed onto the dead list.
+     */
+    template <typename Kind>
+    class PizzaPool
+    {
+    public:
+        static PizzaHandle Acquire()
+        {
+            if (ListGone())
+                return PizzaHandle(new Kind(), Recycle{&Release});
+            auto &vFree = FreeList().vPizzas;
+            Kind *pPizza;
+            if (vFree.empty())
+                pPizza = new Kind();
+            else
+            {
+                pPizza = vFree.back();
+                vFree.pop_back();
+            }
+            return PizzaHandle(pPizza, Recycle{&Release});
+        }
+
+    private:
+        struct List
+        {
+            std::vector<Kind *> vPizzas;
+            ~List()
+            {
+                ListGone() = true;
+                for (Kind *pPizza : vPizzas)
+                    delete pPizza;
+            }
+        };
+
+        static List &FreeList()
+        {
+            thread_local List list;
+            return list;
+        }
+
+        /* Trivially destructible, so it can still be read after the thread's List is gone */
+        static bool &ListGone()
+        {
+            thread_local bool bGone = false;
+            return bGone;
+        }
+
+        static void Release(Pizza *pPizza)
+        {
+            if (ListGone())
+            {
+                delete static_cast<Kind *>(pPizza);
+                return;
+            }
+            FreeList().vPizzas.push_back(static_cast<Kind *>(pPizza));
+        }
+    };
+}
+
+namespace ConcreteProduct
+{
+    class NYStyleCheesePizza : public Product::Pizza
+    {
+    public:
+        NYStyleCheesePizza() : Pizza(Definition()) {}
+
+        static const Product::Recipe &Definition()
+        {
+            static const Product::Recipe recipe("Ny Style Cheese Pizza", "Thin Crust Dough", "Marinara Sauce",
+                                                {"Grated Reggiano Cheese", "Shredded Mozzarella Cheese"});
+            return recipe;
+        }
+    };
+
+    class NYStyleClamPizza : public Product::Pizza
+    {
+    public:
+        NYStyleClamPizza() : Pizza(Definition()) {}
+
+        static const Product::Recipe &Definition()
+        {
+            static const Product::Recipe recipe("Ny Style Clam, Pizza", "Thin Crust Dough", "Marinara Sauce",
+                                                {"Grated Reggiano Cheese", "Shredded Mozzarella Cheese"});
+            return recipe;
+        }
+    };
+    class NYStyleVeggiePizza : public Product::Pizza
+    {
+    public:
+        NYStyleVeggiePizza() : Pizza(Definition()) {}
+
+        static const Product::Recipe &Definition()
+        {
+            static const Product::Recipe recipe("Ny Style Veggie, Pizza", "Thin Crust Dough", "Marinara Sauce",
+                                                {"Basil, Olive Oil", "Mushroom & Jalapeno", "Shredded Mozzarella Cheese"});
+            return recipe;
+        }
+    };
+
+    class ChicagoStyleVeggiePizza : public Product::Pizza
+    {
+    public:
+        ChicagoStyleVeggiePizza() : Pizza(Definition()) {}
+
+        static const Product::Recipe &Definition()
+        {
+            static const Product::Recipe recipe("Ny Style Veggie, Pizza", "Thin Crust Dough", "Marinara Sauce",
+                                                {"Basil, Olive Oil", "Shredded Mozzarella Cheese"});
+            return recipe;
+        }
+    };
+}
+
+namespace Creator
+{
+    /*
+     * Maps an item name to the function that makes it, and to the one that makes a batch of it. Open addressing with
+     * linear probing over a power of two table that is kept at most half full, so a lookup is one hash and usually
+     * one probe, however long the menu.
+     */
+    class ProductRegistry
+    {
+    public:
+        using Factory = Product::PizzaHandle (*)();
+        /* Makes pPizzas[order] for each of vOrders and runs the four stages over them, see MakeBatch */
+        using BatchFactory = void (*)(const std::vector<size_t> &vOrders, Product::PizzaHandle *pPizzas,
+                                      Product::TextBuffer &out);
+        static constexpr size_t kNone = SIZE_MAX;
+
+        void Register(std::string_view szItem, Factory factory, BatchFactory batch)
+        {
+            if (2 * (m_nSize + 1) > m_vSlots.size())
+                Grow();
+            Slot &slot = m_vSlots[Probe(m_vSlots, szItem, Hash(szItem))];
+            if (!slot.factory)
+                ++m_nSize;
+            slot = Slot{Hash(szItem), std::string(szItem), factory, batch};
+        }
+
+        Product::PizzaHandle Create(std::string_view szItem) const
+        {
+            Factory factory = Find(szItem);
+            return factory ? factory() : nullptr;
+        }
+
+        /* The factory for szItem, or null. Each concrete pizza has its own, so it also tells the pizza's type. */
+        Factory Find(std::string_view szItem) const
+        {
+            size_t nIndex = Index(szItem);
+            return nIndex == kNone ? nullptr : m_vSlots[nIndex].factory;
+        }
+
+        /*
+         * The slot of szItem, or kNone. Below SlotCount() and fixed once the menu is registered, so callers can keep
+         * a table indexed by it.
+         */
+        size_t Index(std::string_view szItem) const
+        {
+            if (m_vSlots.empty())
+                return kNone;
+            size_t nIndex = Probe(m_vSlots, szItem, Hash(szItem));
+            return m_vSlots[nIndex].factory ? nIndex : kNone;
+        }
+        size_t SlotCount() const { return m_vSlots.size(); }
+        BatchFactory BatchAt(size_t nIndex) const { return m_vSlots[nIndex].batch; }
+
+    private:
+        struct Slot
+        {
+            uint64_t nHash = 0;
+            std::string szItem;
+            Factory factory = nullptr; // null marks an empty slot
+            BatchFactory batch = nullptr;
+        };
+
+        /* FNV-1a */
+        static uint64_t Hash(std::string_view szItem)
+        {
+            uint64_t nHash = 0xcbf29ce484222325ull;
+            for (char c : szItem)
+                nHash = (nHash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+            return nHash;
+        }
+
+        /* Index of the slot holding szItem, or of the empty slot where it would go. */
+        static size_t Probe(const std::vector<Slot> &vSlots, std::string_view szItem, uint64_t nHash)
+        {
+            const size_t nMask = vSlots.size() - 1;
+            for (size_t i = nHash & nMask;; i = (i + 1) & nMask)
+                if (!vSlots[i].factory || (vSlots[i].nHash == nHash && vSlots[i].szItem == szItem))
+                    return i;
+        }
+
+        void Grow()
+        {
+            std::vector<Slot> vSlots(m_vSlots.empty() ? 16 : 2 * m_vSlots.size());
+            for (auto &slot : m_vSlots)
+                if (slot.factory)
+                    vSlots[Probe(vSlots, slot.szItem, slot.nHash)] = std::move(slot);
+            m_vSlots.swap(vSlots);
+        }
+
+        std::vector<Slot> m_vSlots;
+        size_t m_nSize = 0;
+    };
+
+    class PizzaStore
+    {
+    public:
+        virtual Product::PizzaHandle CreatePizza(std::string_view item) = 0;
+        virtual Product::PizzaHandle OrderPizza(std::string_view type, std::ostream &out = std::cout)
+        {
+            auto pizza = CreatePizza(type);
+            if (pizza == nullptr)
+            {
+                out << "Sorry, we don't make that type of pizza.\n";
+                return nullptr;
+            }
+            pizza->Prepare(out);
+            pizza->Bake(out);
+            pizza->Cut(out);
+            pizza->Box(out);
+
+            return pizza;
+        }
+    };
+
+    /* A store whose menu is its own registry, filled by RegisterPizza objects next to each product. */
+    template <typename Store>
+    class RegisteredPizzaStore : public PizzaStore
+    {
+    public:
+        static ProductRegistry &Registry()
+        {
+            static ProductRegistry registry;
+            return registry;
+        }
+
+    protected:
+        Product::PizzaHandle CreatePizza(std::string_view item) override
+        {
+            return Registry().Create(item);
+        }
+    };
+
+    /*
+     * The batch factory of Kind: every pizza of the group is a Kind, so the stages are called as Kind's own, with no
+     * virtual call, and write into one reused buffer. Runs each stage over the whole group before the next one.
+     */
+    template <typename Kind>
+    void MakeBatch(const std::vector<size_t> &vOrders, Product::PizzaHandle *pPizzas, Product::TextBuffer &out)
+    {
+        for (size_t order : vOrders)
+            pPizzas[order] = Product::PizzaPool<Kind>::Acquire();
+        for (size_t order : vOrders)
+            static_cast<const Kind &>(*pPizzas[order]).Kind::PrepareTo(out);
+        for (size_t order : vOrders)
+            static_cast<const Kind &>(*pPizzas[order]).Kind::BakeTo(out);
+        for (size_t order : vOrders)
+            static_cast<const Kind &>(*pPizzas[order]).Kind::CutTo(out);
+        for (size_t order : vOrders)
+            static_cast<const Kind &>(*pPizzas[order]).Kind::BoxTo(out);
+    }
+
+    /* Adds Pizza to Store's menu under szItem when the program starts, and defines its recipe then too. */
+    template <typename Store, typename Pizza>
+    class RegisterPizza
+    {
+    public:
+        explicit RegisterPizza(std::string_view szItem)
+        {
+            Pizza::Definition();
+            Store::Registry().Register(szItem, &Product::PizzaPool<Pizza>::Acquire, &MakeBatch<Pizza>);
+        }
+    };
+}
+
+namespace ConcreteCreator
+{
+    class NYPizzaStore : public Creator::RegisteredPizzaStore<NYPizzaStore>
+    {
+    };
+    class ChicagoPizzaStore : public Creator::RegisteredPizzaStore<ChicagoPizzaStore>
+    {
+    };
+
+    inline const Creator::RegisterPizza<NYPizzaStore, ConcreteProduct::NYStyleCheesePizza> kNYCheese("cheese");
+    inline const Creator::RegisterPizza<NYPizzaStore, ConcreteProduct::NYStyleClamPizza> kNYClam("clam");
+    inline const Creator::RegisterPizza<NYPizzaStore, ConcreteProduct::NYStyleVeggiePizza> kNYVeggie("veggie");
+    inline const Creator::RegisterPizza<ChicagoPizzaStore, ConcreteProduct::ChicagoStyleVeggiePizza> kChicagoVeggie("veggie");
+}
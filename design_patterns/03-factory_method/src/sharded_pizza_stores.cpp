@@ -0,0 +1,467 @@
+/*
+ * Sharded stores, one thread per core.
+ * A process that runs many franchise stores, NYPizzaStore and ChicagoPizzaStore alike, gives each store to exactly
+ * one Shard: a thread pinned to its own core that owns its stores, its pizza pool and its statistics. Nothing a shard
+ * owns is touched by another thread, so stores need no locks and shards do not share cache lines. The registries are
+ * filled before any shard starts and only read afterwards.
+ * Orders reach a shard through single producer, single consumer queues, one per (producer, shard) pair, so a queue
+ * index is only ever written by one thread. Every shard records the latency from placing an order to its pizza being
+ * boxed in its own histogram.
+ * An order names its item by an id the runtime interned before it started, never by a caller's string, so nothing
+ * a producer owns is read on the shard's thread. Shards are pinned to the CPUs the process may run on, in turn.
+ * main drives the runtime with a load generator thread per shard and reports throughput and per shard latency for
+ * 1, 2 and 3 shards, then powers of two up to the number of usable CPUs and that number itself. Generators are pinned
+ * to CPUs no shard uses when there are enough of them; otherwise they compete with the shards for the CPUs, and no
+ * scaling figure is given for that run.
+ * The products and stores are those of factory_method.cpp, from pizza_store.h.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "pizza_store.h"
+
+namespace Sharded
+{
+    using Clock = std::chrono::steady_clock;
+
+    /*
+     * Ring buffer for one producer thread and one consumer thread. Each side owns its index and keeps a copy of the
+     * other side's, refreshing it only when the ring looks full or empty, so the shared cache lines move rarely.
+     */
+    template <typename T>
+    class SpscQueue
+    {
+    public:
+        explicit SpscQueue(size_t nCapacity) // rounded up to a power of two
+        {
+            size_t nSize = 2;
+            while (nSize < nCapacity)
+                nSize *= 2;
+            m_vSlots.resize(nSize);
+        }
+
+        bool TryPush(const T &value)
+        {
+            size_t nTail = m_nTail.load(std::memory_order_relaxed);
+            if (nTail - m_nHeadSeen == m_vSlots.size())
+            {
+                m_nHeadSeen = m_nHead.load(std::memory_order_acquire);
+                if (nTail - m_nHeadSeen == m_vSlots.size())
+                    return false;
+            }
+            m_vSlots[nTail & (m_vSlots.size() - 1)] = value;
+            m_nTail.store(nTail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool TryPop(T &value)
+        {
+            size_t nHead = m_nHead.load(std::memory_order_relaxed);
+            if (nHead == m_nTailSeen)
+            {
+                m_nTailSeen = m_nTail.load(std::memory_order_acquire);
+                if (nHead == m_nTailSeen)
+                    return false;
+            }
+            value = m_vSlots[nHead & (m_vSlots.size() - 1)];
+            m_nHead.store(nHead + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        std::vector<T> m_vSlots;
+        alignas(64) std::atomic<size_t> m_nTail{0}; // producer side
+        size_t m_nHeadSeen = 0;
+        alignas(64) std::atomic<size_t> m_nHead{0}; // consumer side
+        size_t m_nTailSeen = 0;
+    };
+
+    /*
+     * Latencies in ns. Every power of two is split in kSteps equal buckets, which keeps about 12% resolution from
+     * nanoseconds to seconds in a fixed table; histograms of several shards can be added together.
+     */
+    class LatencyHistogram
+    {
+    public:
+        void Record(uint64_t nNs)
+        {
+            ++m_aCounts[Bucket(nNs)];
+            ++m_nCount;
+            m_nMax = std::max(m_nMax, nNs);
+        }
+
+        void Merge(const LatencyHistogram &other)
+        {
+            for (size_t bucket = 0; bucket < kBuckets; ++bucket)
+                m_aCounts[bucket] += other.m_aCounts[bucket];
+            m_nCount += other.m_nCount;
+            m_nMax = std::max(m_nMax, other.m_nMax);
+        }
+
+        uint64_t Count() const { return m_nCount; }
+        uint64_t Max() const { return m_nMax; }
+
+        /* Upper bound of the bucket holding the given fraction of the samples */
+        uint64_t Percentile(double dFraction) const
+        {
+            uint64_t nRank = static_cast<uint64_t>(dFraction * m_nCount), nSeen = 0;
+            for (size_t bucket = 0; bucket < kBuckets; ++bucket)
+            {
+                nSeen += m_aCounts[bucket];
+                if (nSeen > nRank)
+                    return std::min(UpperBound(bucket), m_nMax);
+            }
+            return m_nMax;
+        }
+
+    private:
+        static constexpr int kStepBits = 3;
+        static constexpr uint64_t kSteps = 1 << kStepBits;
+        static constexpr size_t kBuckets = (64 - kStepBits + 1) * kSteps;
+
+        static size_t Bucket(uint64_t nNs)
+        {
+            if (nNs < kSteps)
+                return static_cast<size_t>(nNs);
+            int nLog = 63 - __builtin_clzll(nNs);
+            uint64_t nStep = (nNs >> (nLog - kStepBits)) & (kSteps - 1);
+            return static_cast<size_t>((nLog - kStepBits + 1) * kSteps + nStep);
+        }
+
+        static uint64_t UpperBound(size_t nBucket)
+        {
+            if (nBucket < kSteps)
+                return nBucket;
+            int nLog = static_cast<int>(nBucket / kSteps) + kStepBits - 1;
+            uint64_t nStep = nBucket % kSteps;
+            return ((kSteps + nStep + 1) << (nLog - kStepBits)) - 1;
+        }
+
+        std::array<uint64_t, kBuckets> m_aCounts{};
+        uint64_t m_nCount = 0;
+        uint64_t m_nMax = 0;
+    };
+
+    /* The CPUs this process may run on, which need not be 0 .. N-1 under a cpuset or taskset. */
+    inline std::vector<unsigned> AllowedCpus()
+    {
+        std::vector<unsigned> vCpus;
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+            for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+                if (CPU_ISSET(cpu, &cpus))
+                    vCpus.push_back(cpu);
+#endif
+        if (vCpus.empty())
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+                vCpus.push_back(cpu);
+        return vCpus;
+    }
+
+    /* Pins the calling thread to nCpu. False if that is not supported or the kernel refused. */
+    inline bool PinToCore(unsigned nCpu)
+    {
+#if defined(__linux__)
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(nCpu, &cpus);
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+        (void)nCpu; // left to the scheduler
+        return false;
+#endif
+    }
+
+    struct Order
+    {
+        uint32_t nStore = 0; // index among the shard's own stores
+        uint32_t nItem = 0;  // id from Runtime::Item
+        Clock::time_point tPlaced;
+    };
+
+    struct ShardStats
+    {
+        uint64_t nMade = 0;
+        uint64_t nRejected = 0;
+        bool bPinned = false;
+        LatencyHistogram latency;
+    };
+
+    class Shard
+    {
+    public:
+        /* vItems is filled before Start and read only afterwards */
+        Shard(unsigned nCpu, const std::deque<std::string> &vItems, size_t nProducers, size_t nQueueCapacity)
+            : m_nCpu(nCpu), m_vItems(vItems)
+        {
+            for (size_t producer = 0; producer < nProducers; ++producer)
+                m_vInboxes.push_back(std::make_unique<SpscQueue<Order>>(nQueueCapacity));
+        }
+
+        /* Before Start only: from then on the store belongs to the shard's thread. Returns its local index. */
+        uint32_t Adopt(std::unique_ptr<Creator::PizzaStore> store)
+        {
+            m_vStores.push_back(std::move(store));
+            return static_cast<uint32_t>(m_vStores.size() - 1);
+        }
+
+        SpscQueue<Order> &Inbox(size_t nProducer) { return *m_vInboxes[nProducer]; }
+
+        void Start() { m_Thread = std::thread(&Shard::Run, this); }
+
+        /* Returns once every order already placed has been served. */
+        void Stop()
+        {
+            m_bStop.store(true, std::memory_order_release);
+            m_Thread.join();
+        }
+
+        /* Only after Stop */
+        const ShardStats &Stats() const { return m_Stats; }
+        unsigned Cpu() const { return m_nCpu; }
+
+    private:
+        void Run()
+        {
+            m_Stats.bPinned = PinToCore(m_nCpu);
+            DiscardBuffer buffer;
+            std::ostream out(&buffer);
+            bool bStopping = false;
+            Order order;
+            for (;;)
+            {
+                bool bIdle = true;
+                for (auto &inbox : m_vInboxes)
+                {
+                    for (int nTaken = 0; nTaken < 64 && inbox->TryPop(order); ++nTaken) // then the next producer
+                    {
+                        Serve(order, out);
+                        bIdle = false;
+                    }
+                }
+                if (!bIdle)
+                    continue;
+                if (bStopping) // a whole pass found nothing after the stop was seen
+                    return;
+                bStopping = m_bStop.load(std::memory_order_acquire);
+                std::this_thread::yield();
+            }
+        }
+
+        void Serve(const Order &order, std::ostream &out)
+        {
+            Product::PizzaHandle pizza = m_vStores[order.nStore]->OrderPizza(m_vItems[order.nItem], out);
+            if (pizza)
+                ++m_Stats.nMade;
+            else
+                ++m_Stats.nRejected;
+            m_Stats.latency.Record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - order.tPlaced).count()));
+        }
+
+        unsigned m_nCpu;
+        const std::deque<std::string> &m_vItems;
+        std::vector<std::unique_ptr<SpscQueue<Order>>> m_vInboxes; // one per producer
+        std::vector<std::unique_ptr<Creator::PizzaStore>> m_vStores;
+        ShardStats m_Stats;
+        std::thread m_Thread;
+        alignas(64) std::atomic<bool> m_bStop{false};
+    };
+
+    /* Routes orders for any store to the shard that owns it. */
+    class Runtime
+    {
+    public:
+        /* Shard i runs on AllowedCpus()[i], wrapping around when there are more shards than CPUs. */
+        Runtime(size_t nShards, size_t nProducers, size_t nQueueCapacity = 1024) : m_nProducers(nProducers)
+        {
+            if (nShards == 0)
+                throw std::invalid_argument("Runtime: at least one shard is needed");
+            std::vector<unsigned> vCpus = AllowedCpus();
+            for (size_t shard = 0; shard < nShards; ++shard)
+                m_vShards.push_back(std::make_unique<Shard>(vCpus[shard % vCpus.size()], m_vItems, nProducers, nQueueCapacity));
+        }
+
+        /* Before Start. The id orders for szItem are placed with; the runtime keeps its own copy of the name. */
+        uint32_t Item(std::string_view szItem)
+        {
+            for (size_t id = 0; id < m_vItems.size(); ++id)
+                if (m_vItems[id] == szItem)
+                    return static_cast<uint32_t>(id);
+            m_vItems.emplace_back(szItem);
+            return static_cast<uint32_t>(m_vItems.size() - 1);
+        }
+
+        /* Before Start. Stores are dealt to the shards in turn; returns the store's id for Place. */
+        size_t AddStore(std::unique_ptr<Creator::PizzaStore> store)
+        {
+            Shard &shard = *m_vShards[m_vRoutes.size() % m_vShards.size()];
+            m_vRoutes.push_back(Route{&shard, shard.Adopt(std::move(store))});
+            return m_vRoutes.size() - 1;
+        }
+
+        void Start()
+        {
+            for (auto &shard : m_vShards)
+                shard->Start();
+        }
+
+        /*
+         * Called by producer nProducer only. False when the store's shard is behind and its inbox is full. Throws
+         * std::out_of_range for a producer or store the runtime was not set up with.
+         */
+        bool TryPlace(size_t nProducer, size_t nStore, uint32_t nItem)
+        {
+            if (nProducer >= m_nProducers || nStore >= m_vRoutes.size())
+                throw std::out_of_range("Runtime::TryPlace: unknown producer or store");
+            const Route &route = m_vRoutes[nStore];
+            return route.pShard->Inbox(nProducer).TryPush(Order{route.nLocal, nItem, Clock::now()});
+        }
+
+        /* Once the producers are done: serves what is queued and stops the shards. */
+        void Stop()
+        {
+            for (auto &shard : m_vShards)
+                shard->Stop();
+        }
+
+        size_t Shards() const { return m_vShards.size(); }
+        const ShardStats &Stats(size_t nShard) const { return m_vShards[nShard]->Stats(); }
+        unsigned Cpu(size_t nShard) const { return m_vShards[nShard]->Cpu(); }
+
+    private:
+        struct Route
+        {
+            Shard *pShard;
+            uint32_t nLocal;
+        };
+
+        size_t m_nProducers;
+        std::deque<std::string> m_vItems; // by item id, read only once started; a deque never moves its elements
+        std::vector<std::unique_ptr<Shard>> m_vShards;
+        std::vector<Route> m_vRoutes; // by store id, read only once started
+    };
+}
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+/* Places nOrders orders for random stores and menu items, waiting whenever a shard pushes back. */
+void GenerateLoad(Sharded::Runtime &runtime, const std::array<uint32_t, 4> &aMenu, size_t nProducer, size_t nStores,
+                  size_t nOrders)
+{
+    uint64_t nState = 0x9e3779b97f4a7c15ull * (nProducer + 1);
+    for (size_t order = 0; order < nOrders; ++order)
+    {
+        nState ^= nState << 13;
+        nState ^= nState >> 7;
+        nState ^= nState << 17;
+        size_t nStore = static_cast<size_t>(nState % nStores);
+        uint32_t nItem = aMenu[(nState >> 32) % 4];
+        while (!runtime.TryPlace(nProducer, nStore, nItem))
+            std::this_thread::yield();
+    }
+}
+
+void PrintLatency(const char *szName, const Sharded::LatencyHistogram &latency)
+{
+    std::cout << szName << latency.Count() << " orders, p50 " << latency.Percentile(0.5) / 1e3 << " us, p99 "
+              << latency.Percentile(0.99) / 1e3 << " us, p99.9 " << latency.Percentile(0.999) / 1e3 << " us, max "
+              << latency.Max() / 1e3 << " us\n";
+}
+
+int main()
+{
+    /* Every shard gets one NY and one Chicago franchise, and a load generator of its own */
+    const size_t nOrdersPerShard = 400000;
+    const std::vector<unsigned> vCpus = Sharded::AllowedCpus();
+    const size_t nCpus = vCpus.size();
+    double dOneShardRate = 0.0; // only from a run whose generators had CPUs of their own
+    bool bAllServed = true;
+
+    /* 3 shards deal stores and CPUs unevenly; beyond the usable CPUs shards share them */
+    std::vector<size_t> vShardCounts = {1, 2, 3};
+    for (size_t nShards = 4; nShards < nCpus; nShards *= 2)
+        vShardCounts.push_back(nShards);
+    if (nCpus > 3)
+        vShardCounts.push_back(nCpus);
+
+    std::cout << "=== " << nOrdersPerShard << " orders per shard, " << nCpus << " usable CPUs ===\n";
+    for (size_t nShards : vShardCounts)
+    {
+        const size_t nStores = 2 * nShards;
+        Sharded::Runtime runtime(nShards, nShards);
+        const std::array<uint32_t, 4> aMenu = {runtime.Item("cheese"), runtime.Item("clam"), runtime.Item("veggie"),
+                                               runtime.Item("veggie")};
+        for (size_t store = 0; store < nStores; ++store)
+        {
+            if (store < nShards) // stores are dealt to the shards in turn
+                runtime.AddStore(std::make_unique<ConcreteCreator::NYPizzaStore>());
+            else
+                runtime.AddStore(std::make_unique<ConcreteCreator::ChicagoPizzaStore>());
+        }
+        runtime.Start();
+
+        /* The shards hold the first nShards CPUs; generator i takes the CPU after them, if there is one. */
+        const bool bSpareCpus = 2 * nShards <= nCpus;
+        std::atomic<size_t> nPinnedGenerators{0};
+        auto start = Sharded::Clock::now();
+        std::vector<std::thread> vGenerators;
+        for (size_t producer = 0; producer < nShards; ++producer)
+            vGenerators.emplace_back([&, producer]
+                                     {
+                if (bSpareCpus && Sharded::PinToCore(vCpus[nShards + producer]))
+                    ++nPinnedGenerators;
+                GenerateLoad(runtime, aMenu, producer, nStores, nOrdersPerShard); });
+        for (auto &generator : vGenerators)
+            generator.join();
+        runtime.Stop();
+        double dSeconds = std::chrono::duration<double>(Sharded::Clock::now() - start).count();
+        const bool bIsolated = nPinnedGenerators == nShards;
+
+        Sharded::LatencyHistogram total;
+        uint64_t nServed = 0;
+        for (size_t shard = 0; shard < nShards; ++shard)
+        {
+            const Sharded::ShardStats &stats = runtime.Stats(shard);
+            total.Merge(stats.latency);
+            nServed += stats.nMade + stats.nRejected;
+        }
+        double dRate = nServed / dSeconds;
+        if (nShards == 1 && bIsolated)
+            dOneShardRate = dRate;
+        bAllServed = bAllServed && nServed == nShards * nOrdersPerShard;
+
+        std::cout << nShards << " shard(s), " << nStores << " stores: " << dRate / 1e6 << " M orders/s, ";
+        if (bIsolated && dOneShardRate > 0.0)
+            std::cout << dRate / dOneShardRate << "x one shard\n";
+        else
+            std::cout << "scaling not measured, load generators share the shards' CPUs\n";
+        for (size_t shard = 0; shard < nShards; ++shard)
+        {
+            const Sharded::ShardStats &stats = runtime.Stats(shard);
+            std::cout << "  shard " << shard << " (" << (stats.bPinned ? "cpu " : "not pinned to cpu ") << runtime.Cpu(shard)
+                      << ") : " << stats.nRejected << " rejected, ";
+            PrintLatency("", stats.latency);
+        }
+        PrintLatency("  all     : ", total);
+    }
+    std::cout << "Every order served: " << (bAllServed ? "yes" : "no") << "\n";
+    return bAllServed ? 0 : 1;
+}
@@ -0,0 +1,1058 @@
+/*
+ * Snake and Ladder simulation service.
+ * An epoll based server on a Unix domain socket that answers batched "simulate" and "solve" requests
+ * for arbitrary boards and dice. Work runs on a worker pool, identical in-flight requests are coalesced
+ * into one computation and finished results are cached by board hash.
+ *
+ * Usage:
+ *   simulation_service serve  <socket path>
+ *   simulation_service client <socket path> [batches] [batch size]
+ *   simulation_service                        (runs server and load-test client in one process)
+ */
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/* WIRE FORMAT */
+/*
+ * Every message is a frame: u32 payload length followed by the payload. All integers are little endian.
+ * Request payload : u16 count, then <count> request items.
+ * Request item    : u32 id, u8 kind, u8 dice faces, u16 board size, u8 jump count,
+ *                   <jump count> x (u16 from, u16 to), u64 games, f64 precision, u64 seed
+ * Response payload: exactly one result item, streamed back as soon as it is ready.
+ */
+namespace Protocol
+{
+    enum class Kind : uint8_t
+    {
+        Simulate = 0, // Monte Carlo run of up to <games> two player games, stopping once the standard error of the
+                      // mean turns is at most <precision> (0 plays them all)
+        Solve = 1     // Expected single player turns, iterated until <precision>
+    };
+
+    enum class Status : uint8_t
+    {
+        Ok = 0,
+        BadRequest = 1
+    };
+
+    struct Jump
+    {
+        uint16_t nFrom;
+        uint16_t nTo;
+    };
+
+    struct Request
+    {
+        uint32_t nId = 0;
+        Kind eKind = Kind::Simulate;
+        uint8_t nDiceFaces = 6;
+        uint16_t nBoardSize = 100;
+        std::vector<Jump> vJumps;
+        uint64_t nGames = 0;
+        double dPrecision = 0.0;
+        uint64_t nSeed = 0;
+    };
+
+    struct Result
+    {
+        uint32_t nId = 0;
+        Status eStatus = Status::Ok;
+        Kind eKind = Kind::Simulate;
+        uint8_t bFromCache = 0;
+        uint64_t nGames = 0;
+        double dMeanTurns = 0.0;
+        double dStdDevTurns = 0.0;
+        double dFirstPlayerWinRate = 0.0;
+        uint32_t nIterations = 0;
+        uint64_t nUnfinished = 0; // games stopped at the turn limit, left out of the turn and win statistics
+    };
+
+    constexpr size_t kMaxFrame = 1 << 20;
+
+    /* Work limits per request, so that no single request holds a worker for long. Larger ones get BadRequest. */
+    constexpr uint64_t kMaxGames = 1000000;
+    constexpr uint64_t kMaxSimulatedTurns = 2000000000ull; // games x turn limit
+    constexpr uint64_t kMaxSolveSteps = 2000000000ull;     // board size x dice faces x iteration limit
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::vector<uint8_t> &buffer) : m_Buffer(buffer) {}
+
+        template <typename T>
+        void Put(T value)
+        {
+            uint8_t bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            m_Buffer.insert(m_Buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+    private:
+        std::vector<uint8_t> &m_Buffer;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(const uint8_t *pData, size_t nSize) : m_pData(pData), m_nSize(nSize) {}
+
+        template <typename T>
+        bool Get(T &value)
+        {
+            if (m_nOffset + sizeof(T) > m_nSize)
+                return false;
+            std::memcpy(&value, m_pData + m_nOffset, sizeof(T));
+            m_nOffset += sizeof(T);
+            return true;
+        }
+
+    private:
+        const uint8_t *m_pData;
+        size_t m_nSize;
+        size_t m_nOffset = 0;
+    };
+
+    /* Writes a complete frame (length prefix included) at the end of buffer. */
+    inline void EncodeBatch(const std::vector<Request> &vRequests, std::vector<uint8_t> &buffer)
+    {
+        size_t nStart = buffer.size();
+        Writer writer(buffer);
+        writer.Put<uint32_t>(0);
+        writer.Put<uint16_t>(static_cast<uint16_t>(vRequests.size()));
+        for (const auto &request : vRequests)
+        {
+            writer.Put(request.nId);
+            writer.Put(static_cast<uint8_t>(request.eKind));
+            writer.Put(request.nDiceFaces);
+            writer.Put(request.nBoardSize);
+            writer.Put(static_cast<uint8_t>(request.vJumps.size()));
+            for (const auto &jump : request.vJumps)
+            {
+                writer.Put(jump.nFrom);
+                writer.Put(jump.nTo);
+            }
+            writer.Put(request.nGames);
+            writer.Put(request.dPrecision);
+            writer.Put(request.nSeed);
+        }
+        uint32_t nPayload = static_cast<uint32_t>(buffer.size() - nStart - sizeof(uint32_t));
+        std::memcpy(buffer.data() + nStart, &nPayload, sizeof(nPayload));
+    }
+
+    inline bool DecodeBatch(const uint8_t *pData, size_t nSize, std::vector<Request> &vRequests)
+    {
+        Reader reader(pData, nSize);
+        uint16_t nCount = 0;
+        if (!reader.Get(nCount))
+            return false;
+        vRequests.resize(nCount);
+        for (auto &request : vRequests)
+        {
+            uint8_t nKind = 0, nJumps = 0;
+            if (!reader.Get(request.nId) || !reader.Get(nKind) || !reader.Get(request.nDiceFaces) ||
+                !reader.Get(request.nBoardSize) || !reader.Get(nJumps))
+                return false;
+            request.eKind = static_cast<Kind>(nKind);
+            request.vJumps.resize(nJumps);
+            for (auto &jump : request.vJumps)
+            {
+                if (!reader.Get(jump.nFrom) || !reader.Get(jump.nTo))
+                    return false;
+            }
+            if (!reader.Get(request.nGames) || !reader.Get(request.dPrecision) || !reader.Get(request.nSeed))
+                return false;
+        }
+        return true;
+    }
+
+    inline void EncodeResult(const Result &result, std::vector<uint8_t> &buffer)
+    {
+        size_t nStart = buffer.size();
+        Writer writer(buffer);
+        writer.Put<uint32_t>(0);
+        writer.Put(result.nId);
+        writer.Put(static_cast<uint8_t>(result.eStatus));
+        writer.Put(static_cast<uint8_t>(result.eKind));
+        writer.Put(result.bFromCache);
+        writer.Put(result.nGames);
+        writer.Put(result.dMeanTurns);
+        writer.Put(result.dStdDevTurns);
+        writer.Put(result.dFirstPlayerWinRate);
+        writer.Put(result.nIterations);
+        writer.Put(result.nUnfinished);
+        uint32_t nPayload = static_cast<uint32_t>(buffer.size() - nStart - sizeof(uint32_t));
+        std::memcpy(buffer.data() + nStart, &nPayload, sizeof(nPayload));
+    }
+
+    inline bool DecodeResult(const uint8_t *pData, size_t nSize, Result &result)
+    {
+        Reader reader(pData, nSize);
+        uint8_t nStatus = 0, nKind = 0;
+        bool bOk = reader.Get(result.nId) && reader.Get(nStatus) && reader.Get(nKind) &&
+                   reader.Get(result.bFromCache) && reader.Get(result.nGames) && reader.Get(result.dMeanTurns) &&
+                   reader.Get(result.dStdDevTurns) && reader.Get(result.dFirstPlayerWinRate) &&
+                   reader.Get(result.nIterations) && reader.Get(result.nUnfinished);
+        result.eStatus = static_cast<Status>(nStatus);
+        result.eKind = static_cast<Kind>(nKind);
+        return bOk;
+    }
+}
+
+/* ENGINE */
+/*
+ * A board is compiled into a flat jump table: m_vJump[cell] is where a token ends up after landing on cell.
+ * Rules follow the interactive game: two players alternate, reaching the last cell exactly wins and an
+ * overshooting roll leaves the token where it is.
+ */
+class CompiledBoard
+{
+public:
+    static bool Compile(const Protocol::Request &request, CompiledBoard &board)
+    {
+        if (request.nBoardSize < 2 || request.nDiceFaces == 0 || request.eKind > Protocol::Kind::Solve)
+            return false;
+
+        board.m_nSize = request.nBoardSize;
+        board.m_vJump.resize(board.m_nSize + 1);
+        for (uint32_t cell = 0; cell <= board.m_nSize; ++cell) // a u16 counter would never pass 65535
+            board.m_vJump[cell] = cell;
+        for (const auto &jump : request.vJumps)
+        {
+            if (jump.nFrom == 0 || jump.nFrom >= board.m_nSize || jump.nTo > board.m_nSize)
+                return false;
+            board.m_vJump[jump.nFrom] = jump.nTo;
+        }
+        return true;
+    }
+
+    uint16_t Size() const { return m_nSize; }
+    uint16_t Next(uint32_t nCell) const { return m_vJump[nCell]; }
+
+private:
+    uint16_t m_nSize = 0;
+    std::vector<uint16_t> m_vJump;
+};
+
+/* FNV-1a over the parts of a request that determine its result. */
+class RequestKey
+{
+public:
+    static uint64_t BoardHash(const Protocol::Request &request)
+    {
+        uint64_t nHash = 1469598103934665603ull;
+        auto mix = [&nHash](uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                nHash ^= (value >> (i * 8)) & 0xff;
+                nHash *= 1099511628211ull;
+            }
+        };
+        mix(request.nBoardSize);
+        for (const auto &jump : request.vJumps)
+            mix((uint64_t(jump.nFrom) << 16) | jump.nTo);
+        return nHash;
+    }
+
+    static uint64_t Of(const Protocol::Request &request)
+    {
+        uint64_t nKey = BoardHash(request);
+        uint64_t nPrecisionBits = 0;
+        std::memcpy(&nPrecisionBits, &request.dPrecision, sizeof(nPrecisionBits));
+        for (uint64_t value : {uint64_t(request.eKind), uint64_t(request.nDiceFaces), request.nGames,
+                               nPrecisionBits, request.nSeed})
+        {
+            nKey ^= value + 0x9e3779b97f4a7c15ull + (nKey << 6) + (nKey >> 2);
+        }
+        return nKey;
+    }
+};
+
+class Simulator
+{
+public:
+    static constexpr uint32_t kMaxIterations = 100000;
+
+    /* Boards made only of snakes may never finish, so every game is cut off after this many turns. */
+    static uint32_t TurnLimit(const CompiledBoard &board) { return 100u * board.Size(); }
+
+    static bool WithinLimits(const Protocol::Request &request, const CompiledBoard &board)
+    {
+        if (!(request.dPrecision >= 0.0)) // negative or NaN
+            return false;
+        if (request.eKind == Protocol::Kind::Solve)
+            return uint64_t(board.Size()) * request.nDiceFaces * kMaxIterations <= Protocol::kMaxSolveSteps;
+        return request.nGames <= Protocol::kMaxGames &&
+               request.nGames * TurnLimit(board) <= Protocol::kMaxSimulatedTurns;
+    }
+
+    /* Games played between two checks of the precision target */
+    static constexpr uint64_t kPrecisionCheck = 1024;
+
+    /*
+     * Seeded runs are deterministic, which is what makes results cacheable. With a precision target the run stops at
+     * the first multiple of kPrecisionCheck games where the standard error of the mean turns is within it; nGames in
+     * the result is the number of games actually played.
+     */
+    static Protocol::Result Simulate(const CompiledBoard &board, uint8_t nFaces, uint64_t nGames, double dPrecision,
+                                     uint64_t nSeed)
+    {
+        Protocol::Result result;
+        uint64_t nState = nSeed ^ 0x2545f4914f6cdd1dull;
+
+        double dSum = 0.0, dSumSq = 0.0;
+        uint64_t nFirstWins = 0;
+        const uint32_t nLast = board.Size();
+        const uint32_t nTurnLimit = TurnLimit(board);
+
+        uint64_t game = 0;
+        for (; game < nGames; ++game)
+        {
+            if (dPrecision > 0.0 && game > 0 && game % kPrecisionCheck == 0)
+            {
+                uint64_t nDone = game - result.nUnfinished;
+                if (nDone > 1)
+                {
+                    double dMean = dSum / nDone;
+                    double dVariance = std::max(0.0, dSumSq / nDone - dMean * dMean);
+                    if (std::sqrt(dVariance / nDone) <= dPrecision)
+                        break;
+                }
+            }
+
+            uint32_t aPos[2] = {0, 0};
+            uint32_t nTurn = 0;
+            int nPlayer = 0;
+            bool bFinished = false;
+            while (nTurn < nTurnLimit)
+            {
+                ++nTurn;
+                uint32_t nNewPos = aPos[nPlayer] + RollDice(nState, nFaces);
+                if (nNewPos <= nLast)
+                    aPos[nPlayer] = board.Next(nNewPos);
+                if (aPos[nPlayer] == nLast) // reached exactly or by a jump, as in Solve
+                {
+                    bFinished = true;
+                    break;
+                }
+                nPlayer = 1 - nPlayer;
+            }
+            if (!bFinished)
+            {
+                ++result.nUnfinished;
+                continue;
+            }
+            nFirstWins += (nPlayer == 0);
+            dSum += nTurn;
+            dSumSq += double(nTurn) * nTurn;
+        }
+
+        result.nGames = game;
+        uint64_t nFinished = game - result.nUnfinished;
+        if (nFinished > 0)
+        {
+            result.dMeanTurns = dSum / nFinished;
+            result.dStdDevTurns = std::sqrt(std::max(0.0, dSumSq / nFinished - result.dMeanTurns * result.dMeanTurns));
+            result.dFirstPlayerWinRate = double(nFirstWins) / nFinished;
+        }
+        return result;
+    }
+
+    /* Expected number of turns for a single player, by Gauss-Seidel iteration on the absorbing chain. */
+    static Protocol::Result Solve(const CompiledBoard &board, uint8_t nFaces, double dPrecision)
+    {
+        Protocol::Result result;
+        const uint32_t nLast = board.Size();
+        std::vector<double> vExpected(nLast + 1, 0.0);
+
+        double dDelta = 0.0;
+        do
+        {
+            dDelta = 0.0;
+            for (int cell = int(nLast) - 1; cell >= 0; --cell)
+            {
+                double dSum = 0.0;
+                for (uint32_t face = 1; face <= nFaces; ++face)
+                {
+                    uint32_t nNewPos = cell + face;
+                    uint32_t nNext = nNewPos > nLast ? cell : board.Next(nNewPos);
+                    dSum += vExpected[nNext];
+                }
+                double dValue = 1.0 + dSum / nFaces;
+                dDelta = std::max(dDelta, std::fabs(dValue - vExpected[cell]));
+                vExpected[cell] = dValue;
+            }
+            ++result.nIterations;
+        } while (dDelta > dPrecision && result.nIterations < kMaxIterations);
+
+        result.dMeanTurns = vExpected[0];
+        return result;
+    }
+
+private:
+    static uint32_t RollDice(uint64_t &nState, uint8_t nFaces)
+    {
+        nState ^= nState >> 12;
+        nState ^= nState << 25;
+        nState ^= nState >> 27;
+        uint32_t nRandom = static_cast<uint32_t>((nState * 0x2545f4914f6cdd1dull) >> 32);
+        return 1 + static_cast<uint32_t>((uint64_t(nRandom) * nFaces) >> 32);
+    }
+};
+
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned nThreads)
+    {
+        for (unsigned i = 0; i < std::max(1u, nThreads); ++i)
+            m_vWorkers.emplace_back([this]
+                                    { Run(); });
+    }
+    ~WorkerPool() { Stop(); }
+
+    /* Runs the tasks already submitted, then joins the workers. Later calls do nothing. */
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_bStopping = true;
+        }
+        m_Condition.notify_all();
+        for (auto &worker : m_vWorkers)
+            worker.join();
+        m_vWorkers.clear();
+    }
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_qTasks.push_back(std::move(task));
+        }
+        m_Condition.notify_one();
+    }
+
+private:
+    void Run()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this]
+                                 { return m_bStopping || !m_qTasks.empty(); });
+                if (m_qTasks.empty())
+                    return;
+                task = std::move(m_qTasks.front());
+                m_qTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::deque<std::function<void()>> m_qTasks;
+    std::vector<std::thread> m_vWorkers;
+    bool m_bStopping = false;
+};
+
+/* Small LRU of finished results. Only touched from the event loop thread. */
+class ResultCache
+{
+public:
+    explicit ResultCache(size_t nCapacity) : m_nCapacity(nCapacity) {}
+
+    bool Find(uint64_t nKey, Protocol::Result &result)
+    {
+        auto it = m_mIndex.find(nKey);
+        if (it == m_mIndex.end())
+            return false;
+        m_lEntries.splice(m_lEntries.begin(), m_lEntries, it->second);
+        result = it->second->second;
+        return true;
+    }
+
+    void Insert(uint64_t nKey, const Protocol::Result &result)
+    {
+        if (m_mIndex.count(nKey))
+            return;
+        m_lEntries.emplace_front(nKey, result);
+        m_mIndex[nKey] = m_lEntries.begin();
+        if (m_lEntries.size() > m_nCapacity)
+        {
+            m_mIndex.erase(m_lEntries.back().first);
+            m_lEntries.pop_back();
+        }
+    }
+
+private:
+    size_t m_nCapacity;
+    std::list<std::pair<uint64_t, Protocol::Result>> m_lEntries;
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Protocol::Result>>::iterator> m_mIndex;
+};
+
+/* SERVER */
+class SimulationServer
+{
+public:
+    SimulationServer(std::string szSocketPath, unsigned nWorkers)
+        : m_szSocketPath(std::move(szSocketPath)), m_Cache(4096), m_Pool(nWorkers) {}
+
+    ~SimulationServer()
+    {
+        m_Pool.Stop(); // tasks still queued post completions and write to m_nWakeFd, so they finish first
+        for (auto &entry : m_mConnections)
+            close(entry.first);
+        if (m_nListenFd >= 0)
+            close(m_nListenFd);
+        if (m_nWakeFd >= 0)
+            close(m_nWakeFd);
+        if (m_nEpollFd >= 0)
+            close(m_nEpollFd);
+        unlink(m_szSocketPath.c_str());
+    }
+
+    bool Start()
+    {
+        m_nListenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_nListenFd < 0)
+            return false;
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (m_szSocketPath.size() >= sizeof(address.sun_path))
+            return false;
+        std::strcpy(address.sun_path, m_szSocketPath.c_str());
+        unlink(m_szSocketPath.c_str());
+        if (bind(m_nListenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+            listen(m_nListenFd, 128) < 0)
+            return false;
+
+        m_nEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        m_nWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_nEpollFd < 0 || m_nWakeFd < 0)
+            return false;
+        Watch(m_nListenFd, EPOLLIN);
+        Watch(m_nWakeFd, EPOLLIN);
+        return true;
+    }
+
+    /* Runs the event loop on the calling thread until Stop() is called. */
+    void Run()
+    {
+        epoll_event aEvents[64];
+        while (!m_bStopping.load(std::memory_order_relaxed))
+        {
+            int nReady = epoll_wait(m_nEpollFd, aEvents, 64, -1);
+            for (int i = 0; i < nReady; ++i)
+            {
+                int fd = aEvents[i].data.fd;
+                if (fd == m_nListenFd)
+                    AcceptAll();
+                else if (fd == m_nWakeFd)
+                    DrainCompletions();
+                else
+                    HandleConnection(fd, aEvents[i].events);
+            }
+        }
+    }
+
+    void Stop()
+    {
+        m_bStopping = true;
+        uint64_t nOne = 1;
+        [[maybe_unused]] ssize_t n = write(m_nWakeFd, &nOne, sizeof(nOne));
+    }
+
+    size_t ComputedCount() const { return m_nComputed; }
+    size_t CoalescedCount() const { return m_nCoalesced; }
+    size_t CacheHitCount() const { return m_nCacheHits; }
+
+private:
+    struct Connection
+    {
+        std::vector<uint8_t> vIn;
+        std::vector<uint8_t> vOut;
+        size_t nOutOffset = 0;
+        bool bWantWrite = false;
+        bool bReadClosed = false; // the client shut down its side: answer what is pending, then close
+        size_t nPending = 0;      // requests still being computed
+    };
+
+    struct Waiter
+    {
+        int fd;
+        uint64_t nGeneration;
+        uint32_t nRequestId;
+    };
+
+    struct Completion
+    {
+        uint64_t nKey;
+        Protocol::Result result;
+    };
+
+    void Watch(int fd, uint32_t nEvents)
+    {
+        epoll_event event{};
+        event.events = nEvents;
+        event.data.fd = fd;
+        epoll_ctl(m_nEpollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void AcceptAll()
+    {
+        while (true)
+        {
+            int fd = accept4(m_nListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+                return;
+            m_mConnections[fd] = Connection{};
+            m_mGenerations[fd] = ++m_nNextGeneration;
+            Watch(fd, EPOLLIN | EPOLLRDHUP);
+        }
+    }
+
+    void CloseConnection(int fd)
+    {
+        epoll_ctl(m_nEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        m_mConnections.erase(fd);
+        m_mGenerations.erase(fd);
+    }
+
+    void HandleConnection(int fd, uint32_t nEvents)
+    {
+        auto it = m_mConnections.find(fd);
+        if (it == m_mConnections.end())
+            return;
+        Connection &connection = it->second;
+
+        if (nEvents & EPOLLIN)
+        {
+            uint8_t aBuffer[64 * 1024];
+            while (true)
+            {
+                ssize_t nRead = read(fd, aBuffer, sizeof(aBuffer));
+                if (nRead > 0)
+                {
+                    connection.vIn.insert(connection.vIn.end(), aBuffer, aBuffer + nRead);
+                    continue;
+                }
+                if (nRead == 0)
+                {
+                    connection.bReadClosed = true;
+                    break;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    CloseConnection(fd);
+                    return;
+                }
+                break;
+            }
+            if (!ParseFrames(fd, connection))
+            {
+                CloseConnection(fd);
+                return;
+            }
+        }
+        if (nEvents & (EPOLLHUP | EPOLLERR))
+        {
+            CloseConnection(fd);
+            return;
+        }
+        Flush(fd, connection);
+    }
+
+    bool ParseFrames(int fd, Connection &connection)
+    {
+        size_t nOffset = 0;
+        std::vector<Protocol::Request> vRequests;
+        while (connection.vIn.size() - nOffset >= sizeof(uint32_t))
+        {
+            uint32_t nPayload = 0;
+            std::memcpy(&nPayload, connection.vIn.data() + nOffset, sizeof(nPayload));
+            if (nPayload > Protocol::kMaxFrame)
+                return false;
+            if (connection.vIn.size() - nOffset - sizeof(uint32_t) < nPayload)
+                break;
+            if (!Protocol::DecodeBatch(connection.vIn.data() + nOffset + sizeof(uint32_t), nPayload, vRequests))
+                return false;
+            for (auto &request : vRequests)
+                Dispatch(fd, connection, std::move(request));
+            nOffset += sizeof(uint32_t) + nPayload;
+        }
+        connection.vIn.erase(connection.vIn.begin(), connection.vIn.begin() + nOffset);
+        return true;
+    }
+
+    /* Answer from cache, join an identical in-flight computation, or start a new one. */
+    void Dispatch(int fd, Connection &connection, Protocol::Request request)
+    {
+        Protocol::Result result;
+        CompiledBoard board;
+        if (!CompiledBoard::Compile(request, board) || !Simulator::WithinLimits(request, board))
+        {
+            result.nId = request.nId;
+            result.eKind = request.eKind;
+            result.eStatus = Protocol::Status::BadRequest;
+            Protocol::EncodeResult(result, connection.vOut);
+            return;
+        }
+
+        uint64_t nKey = RequestKey::Of(request);
+        if (m_Cache.Find(nKey, result))
+        {
+            ++m_nCacheHits;
+            result.nId = request.nId;
+            result.bFromCache = 1;
+            Protocol::EncodeResult(result, connection.vOut);
+            return;
+        }
+
+        auto &vWaiters = m_mInFlight[nKey];
+        vWaiters.push_back(Waiter{fd, m_mGenerations[fd], request.nId});
+        ++connection.nPending;
+        if (vWaiters.size() > 1)
+        {
+            ++m_nCoalesced;
+            return;
+        }
+
+        ++m_nComputed;
+        m_Pool.Submit([this, nKey, board = std::move(board), request = std::move(request)]
+                      {
+            Protocol::Result computed = request.eKind == Protocol::Kind::Solve
+                                            ? Simulator::Solve(board, request.nDiceFaces, request.dPrecision)
+                                            : Simulator::Simulate(board, request.nDiceFaces, request.nGames,
+                                                                  request.dPrecision, request.nSeed);
+            computed.eKind = request.eKind;
+            {
+                std::lock_guard<std::mutex> lock(m_CompletionMutex);
+                m_vCompletions.push_back(Completion{nKey, computed});
+            }
+            uint64_t nOne = 1;
+            [[maybe_unused]] ssize_t n = write(m_nWakeFd, &nOne, sizeof(nOne)); });
+    }
+
+    void DrainCompletions()
+    {
+        uint64_t nCounter = 0;
+        [[maybe_unused]] ssize_t n = read(m_nWakeFd, &nCounter, sizeof(nCounter));
+
+        std::vector<Completion> vDone;
+        {
+            std::lock_guard<std::mutex> lock(m_CompletionMutex);
+            vDone.swap(m_vCompletions);
+        }
+
+        std::vector<int> vTouched;
+        for (auto &done : vDone)
+        {
+            m_Cache.Insert(done.nKey, done.result);
+            auto it = m_mInFlight.find(done.nKey);
+            if (it == m_mInFlight.end())
+                continue;
+            for (const auto &waiter : it->second)
+            {
+                auto generation = m_mGenerations.find(waiter.fd);
+                if (generation == m_mGenerations.end() || generation->second != waiter.nGeneration)
+                    continue; // client went away, the fd may already belong to someone else
+                Protocol::Result result = done.result;
+                result.nId = waiter.nRequestId;
+                Connection &connection = m_mConnections[waiter.fd];
+                Protocol::EncodeResult(result, connection.vOut);
+                --connection.nPending;
+                vTouched.push_back(waiter.fd);
+            }
+            m_mInFlight.erase(it);
+        }
+
+        for (int fd : vTouched)
+        {
+            auto it = m_mConnections.find(fd);
+            if (it != m_mConnections.end())
+                Flush(fd, it->second);
+        }
+    }
+
+    void Flush(int fd, Connection &connection)
+    {
+        while (connection.nOutOffset < connection.vOut.size())
+        {
+            ssize_t nWritten = send(fd, connection.vOut.data() + connection.nOutOffset,
+                                    connection.vOut.size() - connection.nOutOffset, MSG_NOSIGNAL);
+            if (nWritten < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    CloseConnection(fd);
+                    return;
+                }
+                break;
+            }
+            connection.nOutOffset += nWritten;
+        }
+        if (connection.nOutOffset == connection.vOut.size())
+        {
+            connection.vOut.clear();
+            connection.nOutOffset = 0;
+        }
+
+        if (connection.bReadClosed && connection.nPending == 0 && connection.vOut.empty())
+        {
+            CloseConnection(fd);
+            return;
+        }
+
+        /* Once the client has shut down its side, reading would only report the end again. */
+        bool bWantWrite = !connection.vOut.empty();
+        if (bWantWrite != connection.bWantWrite || connection.bReadClosed)
+        {
+            connection.bWantWrite = bWantWrite;
+            epoll_event event{};
+            event.events = (connection.bReadClosed ? 0u : uint32_t(EPOLLIN | EPOLLRDHUP)) |
+                           (bWantWrite ? uint32_t(EPOLLOUT) : 0u);
+            event.data.fd = fd;
+            epoll_ctl(m_nEpollFd, EPOLL_CTL_MOD, fd, &event);
+        }
+    }
+
+    std::string m_szSocketPath;
+    int m_nListenFd = -1;
+    int m_nEpollFd = -1;
+    int m_nWakeFd = -1;
+    std::atomic<bool> m_bStopping{false};
+
+    ResultCache m_Cache;
+    std::unordered_map<int, Connection> m_mConnections;
+    std::unordered_map<int, uint64_t> m_mGenerations;
+    uint64_t m_nNextGeneration = 0;
+    std::unordered_map<uint64_t, std::vector<Waiter>> m_mInFlight;
+
+    std::mutex m_CompletionMutex;
+    std::vector<Completion> m_vCompletions;
+
+    size_t m_nComputed = 0;
+    size_t m_nCoalesced = 0;
+    size_t m_nCacheHits = 0;
+
+    WorkerPool m_Pool; // last, so that it is destroyed first
+};
+
+/* LOAD TEST CLIENT */
+class LoadTestClient
+{
+public:
+    explicit LoadTestClient(std::string szSocketPath) : m_szSocketPath(std::move(szSocketPath)) {}
+
+    bool Run(int nBatches, int nBatchSize)
+    {
+        int fd = Connect();
+        if (fd < 0)
+        {
+            std::cout << "Could not connect to " << m_szSocketPath << "\n";
+            return false;
+        }
+
+        /* A handful of distinct boards so that the load exercises the cache and in-flight coalescing. */
+        std::vector<Protocol::Request> vTemplates = MakeTemplates();
+        std::vector<uint8_t> vOut;
+        uint32_t nNextId = 0;
+        for (int batch = 0; batch < nBatches; ++batch)
+        {
+            std::vector<Protocol::Request> vBatch;
+            for (int i = 0; i < nBatchSize; ++i)
+            {
+                Protocol::Request request = vTemplates[(batch * nBatchSize + i) % vTemplates.size()];
+                request.nId = nNextId++;
+                vBatch.push_back(std::move(request));
+            }
+            Protocol::EncodeBatch(vBatch, vOut);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!SendAll(fd, vOut))
+        {
+            close(fd);
+            return false;
+        }
+
+        size_t nExpected = nNextId, nReceived = 0, nCached = 0, nFailed = 0, nUnfinished = 0;
+        std::vector<uint8_t> vIn;
+        uint8_t aBuffer[64 * 1024];
+        Protocol::Result sample, precise;
+        const uint32_t nPreciseId = static_cast<uint32_t>(vTemplates.size() - 1);
+        while (nReceived < nExpected)
+        {
+            ssize_t nRead = read(fd, aBuffer, sizeof(aBuffer));
+            if (nRead <= 0)
+                break;
+            vIn.insert(vIn.end(), aBuffer, aBuffer + nRead);
+
+            size_t nOffset = 0;
+            uint32_t nPayload = 0;
+            while (vIn.size() - nOffset >= sizeof(uint32_t))
+            {
+                std::memcpy(&nPayload, vIn.data() + nOffset, sizeof(nPayload));
+                if (vIn.size() - nOffset - sizeof(uint32_t) < nPayload)
+                    break;
+                Protocol::Result result;
+                Protocol::DecodeResult(vIn.data() + nOffset + sizeof(uint32_t), nPayload, result);
+                nCached += result.bFromCache;
+                nFailed += result.eStatus != Protocol::Status::Ok;
+                nUnfinished += result.nUnfinished;
+                if (result.nId == 0)
+                    sample = result;
+                if (result.nId == nPreciseId)
+                    precise = result;
+                ++nReceived;
+                nOffset += sizeof(uint32_t) + nPayload;
+            }
+            vIn.erase(vIn.begin(), vIn.begin() + nOffset);
+        }
+        double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        close(fd);
+
+        std::cout << "=== Load test: " << nReceived << "/" << nExpected << " results in " << dSeconds << " s ("
+                  << (nReceived / dSeconds) << " req/s), " << nCached << " from cache, " << nFailed << " failed, " << nUnfinished
+                  << " unfinished games ===\n";
+        std::cout << "Request 0: mean turns " << sample.dMeanTurns << ", std dev " << sample.dStdDevTurns
+                  << ", first player wins " << sample.dFirstPlayerWinRate * 100 << "%\n";
+        std::cout << "Request " << nPreciseId << ": mean turns " << precise.dMeanTurns << " after " << precise.nGames
+                  << " of up to " << vTemplates.back().nGames << " games\n";
+        return nReceived == nExpected;
+    }
+
+private:
+    int Connect()
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, m_szSocketPath.c_str(), sizeof(address.sun_path) - 1);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+            return fd;
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+
+    static bool SendAll(int fd, const std::vector<uint8_t> &vData)
+    {
+        size_t nSent = 0;
+        while (nSent < vData.size())
+        {
+            ssize_t n = send(fd, vData.data() + nSent, vData.size() - nSent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            nSent += n;
+        }
+        return true;
+    }
+
+    static std::vector<Protocol::Request> MakeTemplates()
+    {
+        Protocol::Request classic;
+        classic.vJumps = {{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}, {3, 24}, {21, 43}, {47, 87}, {75, 95}};
+        classic.nGames = 20000;
+        classic.nSeed = 42;
+
+        std::vector<Protocol::Request> vTemplates;
+        for (uint8_t faces : {6, 8})
+        {
+            Protocol::Request simulate = classic;
+            simulate.nDiceFaces = faces;
+            vTemplates.push_back(simulate);
+
+            Protocol::Request solve = classic;
+            solve.eKind = Protocol::Kind::Solve;
+            solve.nDiceFaces = faces;
+            solve.dPrecision = 1e-9;
+            vTemplates.push_back(solve);
+        }
+        Protocol::Request ladders = classic;
+        ladders.vJumps = {{3, 24}, {21, 43}, {47, 87}, {75, 95}};
+        vTemplates.push_back(ladders);
+
+        Protocol::Request untilPrecise = classic; // stops well before its game count
+        untilPrecise.nGames = 200000;
+        untilPrecise.dPrecision = 0.5;
+        vTemplates.push_back(untilPrecise);
+        return vTemplates;
+    }
+
+    std::string m_szSocketPath;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main(int argc, char **argv)
+{
+    std::string szMode = argc > 1 ? argv[1] : "";
+    std::string szPath = argc > 2 ? argv[2] : "/tmp/snake_and_ladder.sock";
+    unsigned nWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+    if (szMode == "serve")
+    {
+        SimulationServer server(szPath, nWorkers);
+        if (!server.Start())
+        {
+            std::cout << "Could not listen on " << szPath << "\n";
+            return 1;
+        }
+        std::cout << "=== Serving on " << szPath << " with " << nWorkers << " workers ===\n";
+        server.Run();
+        return 0;
+    }
+    if (szMode == "client")
+    {
+        int nBatches = argc > 3 ? std::stoi(argv[3]) : 100;
+        int nBatchSize = argc > 4 ? std::stoi(argv[4]) : 64;
+        return LoadTestClient(szPath).Run(nBatches, nBatchSize) ? 0 : 1;
+    }
+
+    /* Self contained demo: server and client in one process. */
+    SimulationServer server(szPath, nWorkers);
+    if (!server.Start())
+    {
+        std::cout << "Could not listen on " << szPath << "\n";
+        return 1;
+    }
+    std::thread loop([&server]
+                     { server.Run(); });
+    bool bOk = LoadTestClient(szPath).Run(100, 64);
+    server.Stop();
+    loop.join();
+
+    std::cout << "Computed " << server.ComputedCount() << ", coalesced " << server.CoalescedCount()
+              << ", cache hits " << server.CacheHitCount() << "\n";
+    return bOk ? 0 : 1;
+}
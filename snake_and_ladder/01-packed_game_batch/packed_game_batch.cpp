@@ -0,0 +1,263 @@
+/*
+ * Bit-packed Snake and Ladder batches.
+ * A Player carries an int position and a heap allocated name, a Game adds a Board and a dice object, so a
+ * game costs well over a hundred bytes spread across the heap. For very large batches each game is packed
+ * into a single 16 bit word instead:
+ *
+ *   bits 0-6  : position of player 0 (0..127)
+ *   bits 7-13 : position of player 1 (0..127)
+ *   bit  14   : whose turn it is (and, once finished, who won)
+ *   bit  15   : finished flag
+ *
+ * Every game of a batch shares one immutable compiled board, and dice rolls come from a counter based
+ * generator keyed by (seed, game index, turn), so a game never needs a pointer or RNG state of its own.
+ * 10^9 games fit in 2 GB.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* BOARD LOGIC */
+/* Immutable jump table shared by every game of a batch: Next(cell) is where a token landing on cell ends up. */
+class CompiledBoard
+{
+public:
+    static constexpr uint32_t kMaxSize = 127; // a position must fit in 7 bits
+
+    /*
+     * Throws std::invalid_argument for boards a packed position cannot address, rather than playing a smaller one,
+     * and for jumps that start off the board's inner cells or end off the board, rather than dropping them.
+     */
+    CompiledBoard(uint32_t nSize, const std::map<int, int> &mSnakes, const std::map<int, int> &mLadders)
+        : m_nSize(nSize)
+    {
+        if (nSize < 2 || nSize > kMaxSize)
+            throw std::invalid_argument("packed boards have 2 to " + std::to_string(kMaxSize) + " squares, not " +
+                                        std::to_string(nSize));
+        for (uint32_t cell = 0; cell < m_aJump.size(); ++cell)
+            m_aJump[cell] = static_cast<uint8_t>(cell);
+        for (const auto &jumps : {mSnakes, mLadders})
+        {
+            for (const auto &jump : jumps)
+            {
+                if (jump.first <= 0 || uint32_t(jump.first) >= m_nSize || jump.second < 0 || uint32_t(jump.second) > m_nSize)
+                    throw std::invalid_argument("jump " + std::to_string(jump.first) + " -> " +
+                                                std::to_string(jump.second) + " is off a board of " +
+                                                std::to_string(m_nSize) + " squares");
+                m_aJump[jump.first] = static_cast<uint8_t>(jump.second);
+            }
+        }
+    }
+
+    uint32_t Size() const { return m_nSize; }
+    uint32_t Next(uint32_t nCell) const { return m_aJump[nCell]; }
+
+private:
+    uint32_t m_nSize;
+    std::array<uint8_t, kMaxSize + 1> m_aJump{};
+};
+
+/* DICE LOGIC */
+/* Stateless dice: the roll for a given game and turn is a pure function of (seed, game, turn). */
+class CounterDice
+{
+public:
+    explicit CounterDice(uint64_t nSeed) : m_nSeed(nSeed) {}
+
+    uint32_t Roll(uint64_t nGame, uint32_t nTurn) const
+    {
+        uint64_t nValue = m_nSeed ^ (nGame * 0x9e3779b97f4a7c15ull) ^ (uint64_t(nTurn) << 40);
+        nValue = (nValue ^ (nValue >> 30)) * 0xbf58476d1ce4e5b9ull;
+        nValue = (nValue ^ (nValue >> 27)) * 0x94d049bb133111ebull;
+        nValue ^= nValue >> 31;
+        return 1 + static_cast<uint32_t>(((nValue >> 32) * 6) >> 32);
+    }
+
+private:
+    uint64_t m_nSeed;
+};
+
+/* PACKED GAME STATE */
+class PackedGame
+{
+public:
+    static constexpr uint16_t kPositionMask = 0x7f;
+    static constexpr uint16_t kTurnBit = 1u << 14;
+    static constexpr uint16_t kFinishedBit = 1u << 15;
+
+    static uint32_t Position(uint16_t nState, uint32_t nPlayer) { return (nState >> (7 * nPlayer)) & kPositionMask; }
+    static uint32_t CurrentPlayer(uint16_t nState) { return (nState & kTurnBit) ? 1 : 0; }
+    static bool IsFinished(uint16_t nState) { return (nState & kFinishedBit) != 0; }
+    static uint32_t Winner(uint16_t nState) { return CurrentPlayer(nState); }
+
+    /* One turn of the interactive game's rules: exact landing on the last cell wins, overshooting stays put. */
+    static uint16_t Step(uint16_t nState, const CompiledBoard &board, uint32_t nRoll)
+    {
+        const uint32_t nPlayer = CurrentPlayer(nState);
+        const uint32_t nShift = 7 * nPlayer;
+        const uint32_t nNewPos = Position(nState, nPlayer) + nRoll;
+
+        if (nNewPos == board.Size())
+            return nState | kFinishedBit;
+        if (nNewPos < board.Size())
+        {
+            nState = static_cast<uint16_t>(nState & ~(kPositionMask << nShift));
+            nState = static_cast<uint16_t>(nState | (board.Next(nNewPos) << nShift));
+        }
+        return nState ^ kTurnBit;
+    }
+};
+
+/* BATCH ENGINE */
+class PackedGameBatch
+{
+public:
+    struct Summary
+    {
+        uint64_t nFinished = 0;
+        uint64_t nFirstPlayerWins = 0;
+        uint64_t nTotalTurns = 0;
+        uint64_t nUnfinished = 0;
+    };
+
+    PackedGameBatch(std::shared_ptr<const CompiledBoard> board, uint64_t nGames, uint64_t nSeed)
+        : m_Board(std::move(board)), m_Dice(nSeed), m_vState(nGames, 0) {}
+
+    uint64_t Size() const { return m_vState.size(); }
+    size_t BytesPerGame() const { return sizeof(decltype(m_vState)::value_type); }
+    uint16_t State(uint64_t nGame) const { return m_vState[nGame]; }
+
+    /*
+     * Plays every game to the end (or nTurnLimit turns). Work is split into cache sized chunks that each
+     * thread runs to completion, which is equivalent to lock-step play because rolls depend only on
+     * (game, turn).
+     */
+    Summary RunToCompletion(uint32_t nTurnLimit, unsigned nThreads)
+    {
+        constexpr uint64_t kChunk = 64 * 1024; // offsets within a chunk fit in 16 bits
+        const uint64_t nChunks = (m_vState.size() + kChunk - 1) / kChunk;
+        nThreads = std::max(1u, nThreads);
+
+        std::vector<Summary> vSummaries(nThreads);
+        std::vector<std::thread> vWorkers;
+        for (unsigned t = 0; t < nThreads; ++t)
+        {
+            vWorkers.emplace_back([&, t]
+                                  {
+                for (uint64_t chunk = t; chunk < nChunks; chunk += nThreads)
+                {
+                    uint64_t nBegin = chunk * kChunk;
+                    uint64_t nEnd = std::min<uint64_t>(nBegin + kChunk, m_vState.size());
+                    RunChunk(nBegin, nEnd, nTurnLimit, vSummaries[t]);
+                } });
+        }
+        for (auto &worker : vWorkers)
+            worker.join();
+
+        Summary total;
+        for (const auto &summary : vSummaries)
+        {
+            total.nFinished += summary.nFinished;
+            total.nFirstPlayerWins += summary.nFirstPlayerWins;
+            total.nTotalTurns += summary.nTotalTurns;
+            total.nUnfinished += summary.nUnfinished;
+        }
+        return total;
+    }
+
+    /* Replays a single game from scratch; it must end in the same state as the batch run. */
+    uint16_t Replay(uint64_t nGame, uint32_t nTurnLimit) const
+    {
+        uint16_t nState = 0;
+        for (uint32_t turn = 0; turn < nTurnLimit && !PackedGame::IsFinished(nState); ++turn)
+            nState = PackedGame::Step(nState, *m_Board, m_Dice.Roll(nGame, turn));
+        return nState;
+    }
+
+private:
+    /* Games still in play are tracked as chunk relative offsets, so the long tail does not rescan finished games. */
+    void RunChunk(uint64_t nBegin, uint64_t nEnd, uint32_t nTurnLimit, Summary &summary)
+    {
+        const CompiledBoard &board = *m_Board;
+        uint16_t *pState = m_vState.data() + nBegin;
+
+        thread_local std::vector<uint16_t> vActive;
+        vActive.resize(nEnd - nBegin);
+        for (uint64_t offset = 0; offset < vActive.size(); ++offset)
+            vActive[offset] = static_cast<uint16_t>(offset);
+        size_t nActive = vActive.size();
+
+        for (uint32_t turn = 0; turn < nTurnLimit && nActive > 0; ++turn)
+        {
+            size_t nKept = 0;
+            for (size_t i = 0; i < nActive; ++i)
+            {
+                const uint16_t nOffset = vActive[i];
+                const uint16_t nState = PackedGame::Step(pState[nOffset], board, m_Dice.Roll(nBegin + nOffset, turn));
+                pState[nOffset] = nState;
+                if (PackedGame::IsFinished(nState))
+                {
+                    ++summary.nFinished;
+                    summary.nTotalTurns += turn + 1;
+                    summary.nFirstPlayerWins += PackedGame::Winner(nState) == 0;
+                }
+                else
+                    vActive[nKept++] = nOffset;
+            }
+            nActive = nKept;
+        }
+        summary.nUnfinished += nActive;
+    }
+
+    std::shared_ptr<const CompiledBoard> m_Board;
+    CounterDice m_Dice;
+    std::vector<uint16_t> m_vState;
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main(int argc, char **argv)
+{
+    uint64_t nGames = argc > 1 ? std::stoull(argv[1]) : 10000000ull;
+    unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    auto board = std::make_shared<const CompiledBoard>(
+        100,
+        std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}},
+        std::map<int, int>{{3, 24}, {21, 43}, {47, 87}, {75, 95}});
+
+    PackedGameBatch batch(board, nGames, 2024);
+    std::cout << "=== " << batch.Size() << " games, " << batch.BytesPerGame() << " bytes each ("
+              << (batch.Size() * batch.BytesPerGame()) / (1024.0 * 1024.0) << " MB) on " << nThreads
+              << " threads ===\n";
+
+    auto start = std::chrono::steady_clock::now();
+    PackedGameBatch::Summary summary = batch.RunToCompletion(100000, nThreads);
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Finished " << summary.nFinished << " games (" << summary.nUnfinished << " unfinished) in "
+              << dSeconds << " s, " << (summary.nFinished / dSeconds) / 1e6 << " M games/s\n";
+    std::cout << "Mean turns per game : " << double(summary.nTotalTurns) / std::max<uint64_t>(1, summary.nFinished)
+              << "\n";
+    std::cout << "First player wins   : " << 100.0 * summary.nFirstPlayerWins / std::max<uint64_t>(1, summary.nFinished)
+              << "%\n";
+
+    for (uint64_t game : {uint64_t(0), nGames / 2, nGames - 1})
+    {
+        if (game < nGames && batch.Replay(game, 100000) != batch.State(game))
+        {
+            std::cout << "Replay of game " << game << " diverged from the batch run!\n";
+            return 1;
+        }
+    }
+    std::cout << "Replayed games match the batch run\n";
+    return 0;
+}
@@ -0,0 +1,360 @@
+/*
+ * Composite dice for Snake and Ladder variants: several dice per roll ("2d6") and exploding dice
+ * ("roll again on six"). The distribution of a whole roll is computed once by convolution and cached per
+ * rule. The simulator samples a complete composite roll with a single alias table draw instead of looping
+ * over dice, and the analytic solver reads the very same distribution.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/* DICE RULES */
+struct DiceRule
+{
+    int nDiceCount = 1;     // dice summed per roll
+    int nFaces = 6;         // faces per die, numbered 1..nFaces
+    bool bExplode = false;  // a die showing its top face is rolled again and added
+    int nMaxExplosions = 3; // re-rolls per die before an exploding die stops
+
+    std::string Name() const
+    {
+        return std::to_string(nDiceCount) + "d" + std::to_string(nFaces) + (bExplode ? "!" : "");
+    }
+    bool operator<(const DiceRule &other) const
+    {
+        return std::tie(nDiceCount, nFaces, bExplode, nMaxExplosions) <
+               std::tie(other.nDiceCount, other.nFaces, other.bExplode, other.nMaxExplosions);
+    }
+};
+
+/*
+ * Probability of every possible roll total plus a Walker alias table over it, so that sampling costs one
+ * random number, one table read and one compare regardless of how many dice the rule has.
+ */
+class RollDistribution
+{
+public:
+    explicit RollDistribution(const DiceRule &rule)
+    {
+        std::vector<double> vDie = SingleDie(rule);
+        m_vProbability = {1.0};
+        for (int i = 0; i < rule.nDiceCount; ++i)
+            m_vProbability = Convolve(m_vProbability, vDie);
+        BuildAliasTable();
+    }
+
+    int MaxRoll() const { return static_cast<int>(m_vProbability.size()) - 1; }
+    double Probability(int nRoll) const { return m_vProbability[nRoll]; }
+
+    double Mean() const
+    {
+        double dMean = 0.0;
+        for (size_t roll = 0; roll < m_vProbability.size(); ++roll)
+            dMean += roll * m_vProbability[roll];
+        return dMean;
+    }
+
+    /* nRandom is 64 uniformly distributed bits. */
+    int Sample(uint64_t nRandom) const
+    {
+        const uint64_t nColumn = ((nRandom >> 32) * m_vAlias.size()) >> 32;
+        const uint32_t nThreshold = static_cast<uint32_t>(nRandom);
+        const AliasEntry &entry = m_vAlias[nColumn];
+        return nThreshold < entry.nThreshold ? static_cast<int>(nColumn) : entry.nAlias;
+    }
+
+private:
+    struct AliasEntry
+    {
+        uint32_t nThreshold; // keep the column when the low 32 bits fall below this
+        int nAlias;
+    };
+
+    static std::vector<double> SingleDie(const DiceRule &rule)
+    {
+        std::vector<double> vFace(rule.nFaces + 1, 0.0);
+        for (int face = 1; face <= rule.nFaces; ++face)
+            vFace[face] = 1.0 / rule.nFaces;
+        if (!rule.bExplode)
+            return vFace;
+
+        /* Exploding die: X = face for face < top, top + X' otherwise, unrolled nMaxExplosions times. */
+        std::vector<double> vDie = vFace;
+        for (int depth = 0; depth < rule.nMaxExplosions; ++depth)
+        {
+            std::vector<double> vNext(vDie.size() + rule.nFaces, 0.0);
+            for (int face = 1; face < rule.nFaces; ++face)
+                vNext[face] += 1.0 / rule.nFaces;
+            for (size_t total = 1; total < vDie.size(); ++total)
+                vNext[rule.nFaces + total] += vDie[total] / rule.nFaces;
+            vDie = std::move(vNext);
+        }
+        return vDie;
+    }
+
+    static std::vector<double> Convolve(const std::vector<double> &vLeft, const std::vector<double> &vRight)
+    {
+        std::vector<double> vResult(vLeft.size() + vRight.size() - 1, 0.0);
+        for (size_t i = 0; i < vLeft.size(); ++i)
+        {
+            if (vLeft[i] == 0.0)
+                continue;
+            for (size_t j = 0; j < vRight.size(); ++j)
+                vResult[i + j] += vLeft[i] * vRight[j];
+        }
+        return vResult;
+    }
+
+    void BuildAliasTable()
+    {
+        const size_t nColumns = m_vProbability.size();
+        std::vector<double> vScaled(nColumns);
+        std::vector<size_t> vSmall, vLarge;
+        for (size_t i = 0; i < nColumns; ++i)
+        {
+            vScaled[i] = m_vProbability[i] * nColumns;
+            (vScaled[i] < 1.0 ? vSmall : vLarge).push_back(i);
+        }
+
+        m_vAlias.assign(nColumns, AliasEntry{UINT32_MAX, 0});
+        while (!vSmall.empty() && !vLarge.empty())
+        {
+            size_t nSmall = vSmall.back(), nLarge = vLarge.back();
+            vSmall.pop_back();
+            m_vAlias[nSmall] = AliasEntry{static_cast<uint32_t>(vScaled[nSmall] * 4294967296.0), static_cast<int>(nLarge)};
+            vScaled[nLarge] -= 1.0 - vScaled[nSmall];
+            if (vScaled[nLarge] < 1.0)
+            {
+                vLarge.pop_back();
+                vSmall.push_back(nLarge);
+            }
+        }
+        /* Whatever is left is 1.0 up to rounding and always keeps its own column. */
+        for (size_t column : vSmall)
+            m_vAlias[column] = AliasEntry{UINT32_MAX, static_cast<int>(column)};
+        for (size_t column : vLarge)
+            m_vAlias[column] = AliasEntry{UINT32_MAX, static_cast<int>(column)};
+    }
+
+    std::vector<double> m_vProbability;
+    std::vector<AliasEntry> m_vAlias;
+};
+
+/* Distributions are computed once per rule and shared by every dice object and solver that uses it. */
+class RollDistributionCache
+{
+public:
+    static std::shared_ptr<const RollDistribution> Get(const DiceRule &rule)
+    {
+        static std::mutex mutex;
+        static std::map<DiceRule, std::shared_ptr<const RollDistribution>> mCache;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &distribution = mCache[rule];
+        if (!distribution)
+            distribution = std::make_shared<const RollDistribution>(rule);
+        return distribution;
+    }
+};
+
+/* DICE LOGIC */
+class IDice
+{
+public:
+    virtual ~IDice() {};
+    virtual int RollDice() = 0;
+};
+
+/* Rolls every die separately, the way a table top player would. Kept as the reference implementation. */
+class LoopingDice : public IDice
+{
+public:
+    LoopingDice(const DiceRule &rule, uint64_t nSeed) : m_Rule(rule), m_Generator(nSeed) {}
+
+    int RollDice() override
+    {
+        std::uniform_int_distribution<> dis(1, m_Rule.nFaces);
+        int nTotal = 0;
+        for (int die = 0; die < m_Rule.nDiceCount; ++die)
+        {
+            int nFace = dis(m_Generator);
+            nTotal += nFace;
+            for (int depth = 0; m_Rule.bExplode && nFace == m_Rule.nFaces && depth < m_Rule.nMaxExplosions; ++depth)
+            {
+                nFace = dis(m_Generator);
+                nTotal += nFace;
+            }
+        }
+        return nTotal;
+    }
+
+private:
+    DiceRule m_Rule;
+    std::mt19937_64 m_Generator;
+};
+
+/* Samples a whole composite roll from the cached distribution with one draw. */
+class CompositeDice : public IDice
+{
+public:
+    CompositeDice(const DiceRule &rule, uint64_t nSeed)
+        : m_Distribution(RollDistributionCache::Get(rule)), m_nState(nSeed ^ 0x9e3779b97f4a7c15ull) {}
+
+    int RollDice() override
+    {
+        m_nState += 0x9e3779b97f4a7c15ull;
+        uint64_t nValue = m_nState;
+        nValue = (nValue ^ (nValue >> 30)) * 0xbf58476d1ce4e5b9ull;
+        nValue = (nValue ^ (nValue >> 27)) * 0x94d049bb133111ebull;
+        return m_Distribution->Sample(nValue ^ (nValue >> 31));
+    }
+
+    const RollDistribution &Distribution() const { return *m_Distribution; }
+
+private:
+    std::shared_ptr<const RollDistribution> m_Distribution;
+    uint64_t m_nState;
+};
+
+/* BOARD LOGIC */
+class Board
+{
+public:
+    /* Throws std::invalid_argument for a board under 2 squares and for jumps that start or end off the board. */
+    Board(int nSize, const std::map<int, int> &mSnakes, const std::map<int, int> &mLadders)
+    {
+        if (nSize < 2)
+            throw std::invalid_argument("a board needs at least 2 squares, not " + std::to_string(nSize));
+        m_vJump.resize(nSize + 1);
+        for (int cell = 0; cell <= nSize; ++cell)
+            m_vJump[cell] = cell;
+        for (const auto &jumps : {mSnakes, mLadders})
+        {
+            for (const auto &jump : jumps)
+            {
+                if (jump.first <= 0 || jump.first >= nSize || jump.second < 0 || jump.second > nSize)
+                    throw std::invalid_argument("jump " + std::to_string(jump.first) + " -> " +
+                                                std::to_string(jump.second) + " is off a board of " +
+                                                std::to_string(nSize) + " squares");
+                m_vJump[jump.first] = jump.second;
+            }
+        }
+    }
+
+    int Size() const { return static_cast<int>(m_vJump.size()) - 1; }
+    int GetNewPosition(int nPosition) const { return m_vJump[nPosition]; }
+
+private:
+    std::vector<int> m_vJump;
+};
+
+/* SOLVER AND SIMULATOR */
+class ExpectedTurnsSolver
+{
+public:
+    /* Expected turns for one player to reach the last cell exactly, iterated until the update is below dPrecision. */
+    static double Solve(const Board &board, const RollDistribution &distribution, double dPrecision)
+    {
+        const int nLast = board.Size();
+        std::vector<double> vExpected(nLast + 1, 0.0);
+        double dDelta = 0.0;
+        int nIterations = 0;
+        do
+        {
+            dDelta = 0.0;
+            for (int cell = nLast - 1; cell >= 0; --cell)
+            {
+                double dStay = 0.0, dSum = 0.0;
+                for (int roll = 0; roll <= distribution.MaxRoll(); ++roll)
+                {
+                    double dProbability = distribution.Probability(roll);
+                    if (dProbability == 0.0)
+                        continue;
+                    if (cell + roll > nLast)
+                        dStay += dProbability;
+                    else
+                        dSum += dProbability * vExpected[board.GetNewPosition(cell + roll)];
+                }
+                /* E = 1 + stay * E + sum  =>  E = (1 + sum) / (1 - stay); a cell every roll overshoots never finishes */
+                if (dStay >= 1.0)
+                {
+                    vExpected[cell] = INFINITY;
+                    continue;
+                }
+                double dValue = (1.0 + dSum) / (1.0 - dStay);
+                dDelta = std::max(dDelta, std::fabs(dValue - vExpected[cell]));
+                vExpected[cell] = dValue;
+            }
+        } while (dDelta > dPrecision && ++nIterations < 100000);
+        return vExpected[0];
+    }
+};
+
+class Simulator
+{
+public:
+    static double MeanTurns(const Board &board, IDice &dice, int nGames)
+    {
+        const int nLast = board.Size();
+        uint64_t nTotalTurns = 0;
+        for (int game = 0; game < nGames; ++game)
+        {
+            int nPosition = 0, nTurns = 0;
+            while (nPosition != nLast && nTurns < 100000)
+            {
+                ++nTurns;
+                int nNewPos = nPosition + dice.RollDice();
+                if (nNewPos <= nLast)
+                    nPosition = board.GetNewPosition(nNewPos);
+            }
+            nTotalTurns += nTurns;
+        }
+        return double(nTotalTurns) / nGames;
+    }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    Board board(100,
+                std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}},
+                std::map<int, int>{{3, 24}, {21, 43}, {47, 87}, {75, 95}});
+
+    const int nGames = 200000;
+    const int nRolls = 20000000;
+    for (const DiceRule &rule : {DiceRule{1, 6, false}, DiceRule{2, 6, false}, DiceRule{1, 6, true}, DiceRule{2, 4, true}})
+    {
+        CompositeDice composite(rule, 7);
+        LoopingDice looping(rule, 7);
+
+        std::cout << "=== " << rule.Name() << " : mean roll " << composite.Distribution().Mean() << ", totals 0.."
+                  << composite.Distribution().MaxRoll() << " ===\n";
+        std::cout << "Solver expected turns    : " << ExpectedTurnsSolver::Solve(board, composite.Distribution(), 1e-10) << "\n";
+        std::cout << "Simulated turns (table)  : " << Simulator::MeanTurns(board, composite, nGames) << "\n";
+        std::cout << "Simulated turns (loop)   : " << Simulator::MeanTurns(board, looping, nGames) << "\n";
+
+        for (IDice *dice : {static_cast<IDice *>(&composite), static_cast<IDice *>(&looping)})
+        {
+            auto start = std::chrono::steady_clock::now();
+            int64_t nSum = 0;
+            for (int roll = 0; roll < nRolls; ++roll)
+                nSum += dice->RollDice();
+            double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << (dice == &composite ? "Table draw" : "Dice loop ") << " : " << (dSeconds * 1e9 / nRolls)
+                      << " ns/roll (mean " << double(nSum) / nRolls << ")\n";
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
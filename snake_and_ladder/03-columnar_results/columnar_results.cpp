@@ -0,0 +1,800 @@
+/*
+ * Columnar per-game results for large Snake and Ladder simulation runs.
+ * Every finished game produces a row (game id, winner, rounds, snake hits, ladder hits). Rows are stored
+ * column by column in row groups, each column page compressed with frame-of-reference bit-packing (plus
+ * delta coding for increasing columns such as the game id).
+ *
+ * Each worker thread appends to its own Appender, so appending takes no shared lock; full row groups are
+ * encoded by the worker and handed to a background flusher that writes them out. The Reader maps the
+ * file, and scans only the projected columns.
+ *
+ * File layout:
+ *   "SLCR" u32 version, u32 column count, per column: u8 type, u8 name length, name
+ *   row groups: u32 row count, per column: u8 encoding, u8 bit width, u64 first, u64 reference,
+ *               u32 payload bytes, payload
+ *   footer: u64 offset per row group, u32 row group count, "SLCR"
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* SCHEMA */
+namespace Schema
+{
+    enum class Type : uint8_t
+    {
+        UInt8,
+        UInt16,
+        UInt32,
+        UInt64
+    };
+
+    struct Column
+    {
+        std::string szName;
+        Type eType;
+    };
+
+    /* One finished game. */
+    struct GameRecord
+    {
+        uint64_t nGameId;
+        uint8_t nWinner;
+        uint32_t nRounds;
+        uint16_t nSnakeHits;
+        uint16_t nLadderHits;
+    };
+
+    enum ColumnIndex
+    {
+        GameId,
+        Winner,
+        Rounds,
+        SnakeHits,
+        LadderHits,
+        ColumnCount
+    };
+
+    inline const std::vector<Column> &GameColumns()
+    {
+        static const std::vector<Column> vColumns = {
+            {"game_id", Type::UInt64},
+            {"winner", Type::UInt8},
+            {"rounds", Type::UInt32},
+            {"snake_hits", Type::UInt16},
+            {"ladder_hits", Type::UInt16}};
+        return vColumns;
+    }
+}
+
+/* ENCODING */
+namespace Encoding
+{
+    enum class Kind : uint8_t
+    {
+        FrameOfReference = 0, // value = reference + packed
+        Delta = 1             // value[i] = value[i - 1] + reference + packed[i], value[0] = first
+    };
+
+    constexpr uint32_t kRawWidth = 64; // widths above 56 bits are stored as plain 64 bit words
+    constexpr size_t kPadding = 8;     // lets the decoder use unaligned 64 bit loads at the very end
+
+    struct PageHeader
+    {
+        Kind eKind;
+        uint8_t nWidth;
+        uint64_t nFirst;
+        uint64_t nReference;
+        uint32_t nBytes;
+    };
+
+    inline uint32_t BitWidth(uint64_t nValue)
+    {
+        return nValue == 0 ? 0 : 64 - __builtin_clzll(nValue);
+    }
+
+    template <typename T>
+    void Put(std::vector<uint8_t> &vOut, T value)
+    {
+        uint8_t aBytes[sizeof(T)];
+        std::memcpy(aBytes, &value, sizeof(T));
+        vOut.insert(vOut.end(), aBytes, aBytes + sizeof(T));
+    }
+
+    template <typename T>
+    T Get(const uint8_t *&pIn)
+    {
+        T value;
+        std::memcpy(&value, pIn, sizeof(T));
+        pIn += sizeof(T);
+        return value;
+    }
+
+    inline void Pack(const uint64_t *pValues, size_t nCount, uint32_t nWidth, std::vector<uint8_t> &vOut)
+    {
+        size_t nStart = vOut.size();
+        size_t nBytes = nWidth == kRawWidth ? nCount * 8 : (nCount * nWidth + 7) / 8;
+        vOut.resize(nStart + nBytes + kPadding, 0);
+        uint8_t *pOut = vOut.data() + nStart;
+        if (nWidth == kRawWidth)
+        {
+            std::memcpy(pOut, pValues, nCount * 8);
+            return;
+        }
+        if (nWidth == 0)
+            return;
+        for (size_t i = 0; i < nCount; ++i)
+        {
+            size_t nBit = i * nWidth;
+            uint64_t nWord;
+            std::memcpy(&nWord, pOut + (nBit >> 3), 8);
+            nWord |= pValues[i] << (nBit & 7);
+            std::memcpy(pOut + (nBit >> 3), &nWord, 8);
+        }
+    }
+
+    /* Width is a template parameter so shifts and masks are constants and the loop unrolls. */
+    template <uint32_t Width>
+    void UnpackFixed(const uint8_t *pIn, size_t nCount, uint64_t nReference, uint64_t *pValues)
+    {
+        constexpr uint64_t nMask = (uint64_t(1) << Width) - 1;
+        size_t i = 0;
+        for (; i + 8 <= nCount; i += 8)
+        {
+            /* Eight values always span exactly Width bytes. */
+            const uint8_t *pGroup = pIn + (i / 8) * Width;
+            for (uint32_t j = 0; j < 8; ++j)
+            {
+                uint64_t nWord;
+                std::memcpy(&nWord, pGroup + (j * Width) / 8, 8);
+                pValues[i + j] = ((nWord >> ((j * Width) % 8)) & nMask) + nReference;
+            }
+        }
+        for (; i < nCount; ++i)
+        {
+            uint64_t nWord;
+            std::memcpy(&nWord, pIn + (i * Width) / 8, 8);
+            pValues[i] = ((nWord >> ((i * Width) % 8)) & nMask) + nReference;
+        }
+    }
+
+    /* nWidth is 1..56; the reader rejects pages with any other packed width before decoding them. */
+    template <uint32_t... Widths>
+    void UnpackDispatch(std::integer_sequence<uint32_t, Widths...>, const uint8_t *pIn, size_t nCount,
+                        uint32_t nWidth, uint64_t nReference, uint64_t *pValues)
+    {
+        using Unpacker = void (*)(const uint8_t *, size_t, uint64_t, uint64_t *);
+        static constexpr Unpacker aUnpackers[] = {&UnpackFixed<Widths + 1>...};
+        aUnpackers[nWidth - 1](pIn, nCount, nReference, pValues);
+    }
+
+    /* Writes reference + packed[i] into pValues. */
+    inline void Unpack(const uint8_t *pIn, size_t nCount, uint32_t nWidth, uint64_t nReference, uint64_t *pValues)
+    {
+        if (nWidth == kRawWidth)
+        {
+            std::memcpy(pValues, pIn, nCount * 8);
+            for (size_t i = 0; i < nCount; ++i)
+                pValues[i] += nReference;
+            return;
+        }
+        if (nWidth == 0)
+        {
+            std::fill(pValues, pValues + nCount, nReference);
+            return;
+        }
+        UnpackDispatch(std::make_integer_sequence<uint32_t, 56>{}, pIn, nCount, nWidth, nReference, pValues);
+    }
+
+    /* Picks delta coding for non-decreasing columns when it packs tighter than plain frame of reference. */
+    inline void EncodePage(const uint64_t *pValues, size_t nCount, std::vector<uint8_t> &vOut,
+                           std::vector<uint64_t> &vScratch)
+    {
+        uint64_t nMin = nCount ? pValues[0] : 0, nMax = nMin;
+        bool bIncreasing = true;
+        uint64_t nMinDelta = UINT64_MAX, nMaxDelta = 0;
+        for (size_t i = 0; i < nCount; ++i)
+        {
+            nMin = std::min(nMin, pValues[i]);
+            nMax = std::max(nMax, pValues[i]);
+            if (i > 0)
+            {
+                bIncreasing = bIncreasing && pValues[i] >= pValues[i - 1];
+                uint64_t nDelta = pValues[i] - pValues[i - 1];
+                nMinDelta = std::min(nMinDelta, nDelta);
+                nMaxDelta = std::max(nMaxDelta, nDelta);
+            }
+        }
+
+        PageHeader header{Kind::FrameOfReference, 0, 0, nMin, 0};
+        uint32_t nWidth = BitWidth(nMax - nMin);
+        vScratch.resize(nCount);
+        if (bIncreasing && nCount > 1 && BitWidth(nMaxDelta - nMinDelta) < nWidth)
+        {
+            header.eKind = Kind::Delta;
+            header.nFirst = pValues[0];
+            header.nReference = nMinDelta;
+            nWidth = BitWidth(nMaxDelta - nMinDelta);
+            vScratch[0] = 0;
+            for (size_t i = 1; i < nCount; ++i)
+                vScratch[i] = pValues[i] - pValues[i - 1] - nMinDelta;
+        }
+        else
+        {
+            for (size_t i = 0; i < nCount; ++i)
+                vScratch[i] = pValues[i] - nMin;
+        }
+        header.nWidth = static_cast<uint8_t>(nWidth > 56 ? kRawWidth : nWidth);
+
+        Put(vOut, static_cast<uint8_t>(header.eKind));
+        Put(vOut, header.nWidth);
+        Put(vOut, header.nFirst);
+        Put(vOut, header.nReference);
+        size_t nBytesAt = vOut.size();
+        Put<uint32_t>(vOut, 0);
+        size_t nPayloadAt = vOut.size();
+        Pack(vScratch.data(), nCount, header.nWidth, vOut);
+        uint32_t nBytes = static_cast<uint32_t>(vOut.size() - nPayloadAt);
+        std::memcpy(vOut.data() + nBytesAt, &nBytes, sizeof(nBytes));
+    }
+
+    inline PageHeader ReadPageHeader(const uint8_t *&pIn)
+    {
+        PageHeader header;
+        header.eKind = static_cast<Kind>(Get<uint8_t>(pIn));
+        header.nWidth = Get<uint8_t>(pIn);
+        header.nFirst = Get<uint64_t>(pIn);
+        header.nReference = Get<uint64_t>(pIn);
+        header.nBytes = Get<uint32_t>(pIn);
+        return header;
+    }
+
+    /* Payload bytes a page of nCount values at nWidth bits must have for Unpack to stay inside it */
+    inline uint64_t PayloadBytes(uint64_t nCount, uint32_t nWidth)
+    {
+        if (nWidth == kRawWidth)
+            return nCount * 8;
+        return (nCount * nWidth + 7) / 8 + (nWidth == 0 ? 0 : kPadding);
+    }
+
+    inline void DecodePage(const PageHeader &header, const uint8_t *pPayload, size_t nCount, uint64_t *pValues)
+    {
+        Unpack(pPayload, nCount, header.nWidth, header.nReference, pValues);
+        if (header.eKind == Kind::FrameOfReference || nCount == 0)
+            return;
+        uint64_t nValue = header.nFirst;
+        pValues[0] = nValue;
+        for (size_t i = 1; i < nCount; ++i)
+        {
+            nValue += pValues[i];
+            pValues[i] = nValue;
+        }
+    }
+}
+
+/* WRITER */
+class ColumnarWriter
+{
+public:
+    static constexpr size_t kRowGroupSize = 64 * 1024;
+
+    /* Thread owned row group builder. Appending touches only this object. */
+    class Appender
+    {
+    public:
+        explicit Appender(ColumnarWriter &writer) : m_Writer(writer), m_vColumns(Schema::ColumnCount)
+        {
+            for (auto &column : m_vColumns)
+                column.reserve(kRowGroupSize);
+        }
+        ~Appender() { Flush(); }
+        Appender(const Appender &) = delete;
+        Appender &operator=(const Appender &) = delete;
+
+        void Append(const Schema::GameRecord &record)
+        {
+            m_vColumns[Schema::GameId].push_back(record.nGameId);
+            m_vColumns[Schema::Winner].push_back(record.nWinner);
+            m_vColumns[Schema::Rounds].push_back(record.nRounds);
+            m_vColumns[Schema::SnakeHits].push_back(record.nSnakeHits);
+            m_vColumns[Schema::LadderHits].push_back(record.nLadderHits);
+            if (m_vColumns[0].size() == kRowGroupSize)
+                Flush();
+        }
+
+        /* Encodes the pending rows on this thread and hands the bytes to the background flusher. */
+        void Flush()
+        {
+            size_t nRows = m_vColumns[0].size();
+            if (nRows == 0)
+                return;
+            std::vector<uint8_t> vRowGroup;
+            Encoding::Put<uint32_t>(vRowGroup, static_cast<uint32_t>(nRows));
+            for (auto &column : m_vColumns)
+            {
+                Encoding::EncodePage(column.data(), nRows, vRowGroup, m_vScratch);
+                column.clear();
+            }
+            m_Writer.Enqueue(std::move(vRowGroup));
+        }
+
+    private:
+        ColumnarWriter &m_Writer;
+        std::vector<std::vector<uint64_t>> m_vColumns;
+        std::vector<uint64_t> m_vScratch;
+    };
+
+    explicit ColumnarWriter(const std::string &szPath) : m_pFile(std::fopen(szPath.c_str(), "wb"))
+    {
+        if (!m_pFile)
+            return;
+        std::vector<uint8_t> vHeader;
+        vHeader.insert(vHeader.end(), {'S', 'L', 'C', 'R'});
+        Encoding::Put<uint32_t>(vHeader, 1);
+        Encoding::Put<uint32_t>(vHeader, static_cast<uint32_t>(Schema::GameColumns().size()));
+        for (const auto &column : Schema::GameColumns())
+        {
+            Encoding::Put(vHeader, static_cast<uint8_t>(column.eType));
+            Encoding::Put(vHeader, static_cast<uint8_t>(column.szName.size()));
+            vHeader.insert(vHeader.end(), column.szName.begin(), column.szName.end());
+        }
+        Write(vHeader);
+        m_nOffset = vHeader.size();
+        m_Flusher = std::thread([this]
+                                { FlushLoop(); });
+    }
+
+    ~ColumnarWriter() { Close(); }
+
+    bool IsOpen() const { return m_pFile != nullptr; }
+
+    /* All appenders must be destroyed (or flushed) before closing. False if any part of the file failed to write. */
+    bool Close()
+    {
+        if (!m_pFile)
+            return !m_bFailed;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_bClosing = true;
+        }
+        m_Condition.notify_one();
+        m_Flusher.join();
+
+        std::vector<uint8_t> vFooter;
+        for (uint64_t nOffset : m_vRowGroupOffsets)
+            Encoding::Put(vFooter, nOffset);
+        Encoding::Put<uint32_t>(vFooter, static_cast<uint32_t>(m_vRowGroupOffsets.size()));
+        vFooter.insert(vFooter.end(), {'S', 'L', 'C', 'R'});
+        Write(vFooter);
+        if (std::fclose(m_pFile) != 0)
+            m_bFailed = true;
+        m_pFile = nullptr;
+        return !m_bFailed;
+    }
+
+    uint64_t BytesWritten() const { return m_nOffset; }
+
+private:
+    /* Called from the constructor, the flusher and Close, never at the same time */
+    void Write(const std::vector<uint8_t> &vBytes)
+    {
+        if (std::fwrite(vBytes.data(), 1, vBytes.size(), m_pFile) != vBytes.size())
+            m_bFailed = true;
+    }
+
+    void Enqueue(std::vector<uint8_t> vRowGroup)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_qPending.push_back(std::move(vRowGroup));
+        }
+        m_Condition.notify_one();
+    }
+
+    void FlushLoop()
+    {
+        while (true)
+        {
+            std::deque<std::vector<uint8_t>> qBatch;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this]
+                                 { return m_bClosing || !m_qPending.empty(); });
+                if (m_qPending.empty())
+                    return;
+                qBatch.swap(m_qPending);
+            }
+            for (const auto &vRowGroup : qBatch)
+            {
+                m_vRowGroupOffsets.push_back(m_nOffset);
+                Write(vRowGroup);
+                m_nOffset += vRowGroup.size();
+            }
+        }
+    }
+
+    std::FILE *m_pFile;
+    bool m_bFailed = false;
+    uint64_t m_nOffset = 0;
+    std::vector<uint64_t> m_vRowGroupOffsets;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::deque<std::vector<uint8_t>> m_qPending;
+    bool m_bClosing = false;
+    std::thread m_Flusher;
+};
+
+/* READER */
+class ColumnarReader
+{
+public:
+    /* Decoded values of the projected columns for one row group; unprojected columns stay empty. */
+    struct Batch
+    {
+        size_t nRows = 0;
+        std::vector<std::vector<uint64_t>> vColumns;
+    };
+
+    explicit ColumnarReader(const std::string &szPath)
+    {
+        int fd = open(szPath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info{};
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            m_nSize = static_cast<size_t>(info.st_size);
+            void *pMapped = mmap(nullptr, m_nSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            m_pData = pMapped == MAP_FAILED ? nullptr : static_cast<const uint8_t *>(pMapped);
+        }
+        close(fd);
+        if (!m_pData)
+            m_szError = "cannot map the file";
+        else if (!ParseLayout())
+        {
+            munmap(const_cast<uint8_t *>(m_pData), m_nSize);
+            m_pData = nullptr;
+        }
+    }
+
+    ~ColumnarReader()
+    {
+        if (m_pData)
+            munmap(const_cast<uint8_t *>(m_pData), m_nSize);
+    }
+
+    bool IsOpen() const { return m_pData != nullptr; }
+    /* Why the file could not be opened */
+    const std::string &Error() const { return m_szError; }
+    const std::vector<Schema::Column> &Columns() const { return m_vColumns; }
+    size_t RowGroupCount() const { return m_vRowGroupOffsets.size(); }
+
+    int ColumnIndex(const std::string &szName) const
+    {
+        for (size_t i = 0; i < m_vColumns.size(); ++i)
+            if (m_vColumns[i].szName == szName)
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    /*
+     * Calls visitor(nThread, batch) once per row group, decoding only the columns named in vProjection.
+     * Row groups are spread over nThreads threads; the visitor is called concurrently from different threads
+     * and nThread identifies the caller so it can accumulate without sharing.
+     */
+    template <typename Visitor>
+    void Scan(const std::vector<std::string> &vProjection, unsigned nThreads, Visitor &&visitor) const
+    {
+        std::vector<bool> vWanted(m_vColumns.size(), false);
+        for (const auto &szName : vProjection)
+        {
+            int nIndex = ColumnIndex(szName);
+            if (nIndex >= 0)
+                vWanted[nIndex] = true;
+        }
+
+        auto scanPart = [&](unsigned nThread)
+        {
+            Batch batch;
+            batch.vColumns.resize(m_vColumns.size());
+            for (size_t group = nThread; group < m_vRowGroupOffsets.size(); group += nThreads)
+            {
+                const uint8_t *pIn = m_pData + m_vRowGroupOffsets[group];
+                batch.nRows = Encoding::Get<uint32_t>(pIn);
+                for (size_t column = 0; column < m_vColumns.size(); ++column)
+                {
+                    Encoding::PageHeader header = Encoding::ReadPageHeader(pIn);
+                    if (vWanted[column])
+                    {
+                        batch.vColumns[column].resize(batch.nRows);
+                        Encoding::DecodePage(header, pIn, batch.nRows, batch.vColumns[column].data());
+                    }
+                    pIn += header.nBytes;
+                }
+                visitor(nThread, static_cast<const Batch &>(batch));
+            }
+        };
+
+        nThreads = std::max(1u, nThreads);
+        std::vector<std::thread> vWorkers;
+        for (unsigned t = 1; t < nThreads; ++t)
+            vWorkers.emplace_back(scanPart, t);
+        scanPart(0);
+        for (auto &worker : vWorkers)
+            worker.join();
+    }
+
+private:
+    bool Fail(const char *szError)
+    {
+        m_szError = szError;
+        return false;
+    }
+
+    /*
+     * Checks everything Scan will read: the column table, the footer, every row group offset and every page header
+     * and payload, so that a corrupt or truncated file is rejected here instead of being read out of bounds.
+     */
+    bool ParseLayout()
+    {
+        if (m_nSize < 12 + 8 || std::memcmp(m_pData, "SLCR", 4) != 0 || std::memcmp(m_pData + m_nSize - 4, "SLCR", 4) != 0)
+            return Fail("not a columnar results file");
+
+        const uint8_t *pIn = m_pData + 4;
+        const uint8_t *pFooter = m_pData + m_nSize - 8;
+        uint32_t nVersion = Encoding::Get<uint32_t>(pIn);
+        uint32_t nColumns = Encoding::Get<uint32_t>(pIn);
+        if (nVersion != 1)
+            return Fail("unsupported version");
+        for (uint32_t i = 0; i < nColumns; ++i)
+        {
+            if (pFooter - pIn < 2)
+                return Fail("column table runs past the end of the file");
+            Schema::Column column;
+            uint8_t nType = Encoding::Get<uint8_t>(pIn);
+            uint8_t nLength = Encoding::Get<uint8_t>(pIn);
+            if (nType > static_cast<uint8_t>(Schema::Type::UInt64))
+                return Fail("unknown column type");
+            if (pFooter - pIn < nLength)
+                return Fail("column table runs past the end of the file");
+            column.eType = static_cast<Schema::Type>(nType);
+            column.szName.assign(reinterpret_cast<const char *>(pIn), nLength);
+            pIn += nLength;
+            m_vColumns.push_back(std::move(column));
+        }
+        const uint64_t nDataStart = static_cast<uint64_t>(pIn - m_pData);
+
+        uint32_t nRowGroups = Encoding::Get<uint32_t>(pFooter);
+        if ((m_nSize - 8 - nDataStart) / 8 < nRowGroups)
+            return Fail("row group index runs past the start of the file");
+        const uint64_t nDataEnd = m_nSize - 8 - uint64_t(nRowGroups) * 8;
+        const uint8_t *pOffsets = m_pData + nDataEnd;
+        for (uint32_t i = 0; i < nRowGroups; ++i)
+        {
+            uint64_t nOffset = Encoding::Get<uint64_t>(pOffsets);
+            if (!CheckRowGroup(nOffset, nDataStart, nDataEnd))
+                return false;
+            m_vRowGroupOffsets.push_back(nOffset);
+        }
+        return true;
+    }
+
+    bool CheckRowGroup(uint64_t nOffset, uint64_t nDataStart, uint64_t nDataEnd)
+    {
+        constexpr uint64_t kPageHeaderBytes = 1 + 1 + 8 + 8 + 4;
+        if (nOffset < nDataStart || nOffset > nDataEnd || nDataEnd - nOffset < 4)
+            return Fail("row group offset outside the data");
+        const uint8_t *pIn = m_pData + nOffset;
+        uint32_t nRows = Encoding::Get<uint32_t>(pIn);
+        if (nRows > ColumnarWriter::kRowGroupSize) // a constant page needs no payload, so bound what Scan allocates
+            return Fail("row group larger than a writer makes");
+        for (size_t column = 0; column < m_vColumns.size(); ++column)
+        {
+            uint64_t nLeft = nDataEnd - static_cast<uint64_t>(pIn - m_pData);
+            if (nLeft < kPageHeaderBytes)
+                return Fail("page header runs past the data");
+            Encoding::PageHeader header = Encoding::ReadPageHeader(pIn);
+            nLeft -= kPageHeaderBytes;
+            if (header.eKind != Encoding::Kind::FrameOfReference && header.eKind != Encoding::Kind::Delta)
+                return Fail("unknown page encoding");
+            if (header.nWidth > 56 && header.nWidth != Encoding::kRawWidth)
+                return Fail("page bit width is neither 0..56 nor 64");
+            if (header.nBytes > nLeft)
+                return Fail("page payload runs past the data");
+            if (header.nBytes < Encoding::PayloadBytes(nRows, header.nWidth))
+                return Fail("page payload is too short for its rows");
+            pIn += header.nBytes;
+        }
+        return true;
+    }
+
+    const uint8_t *m_pData = nullptr;
+    size_t m_nSize = 0;
+    std::vector<Schema::Column> m_vColumns;
+    std::vector<uint64_t> m_vRowGroupOffsets;
+    std::string m_szError;
+};
+
+/* SIMULATION */
+/* Plays one two player game on the classic board and records what happened. */
+class GameRecorder
+{
+public:
+    GameRecorder()
+    {
+        for (int cell = 0; cell <= 100; ++cell)
+            m_aJump[cell] = cell;
+        for (const auto &snake : std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}})
+            m_aJump[snake.first] = snake.second;
+        for (const auto &ladder : std::map<int, int>{{3, 24}, {21, 43}, {47, 87}, {75, 95}})
+            m_aJump[ladder.first] = ladder.second;
+    }
+
+    Schema::GameRecord Play(uint64_t nGameId) const
+    {
+        Schema::GameRecord record{nGameId, 0, 0, 0, 0};
+        uint64_t nState = nGameId * 0x9e3779b97f4a7c15ull + 0x2545f4914f6cdd1dull;
+        int aPosition[2] = {0, 0};
+        int nPlayer = 0;
+        while (true)
+        {
+            nState ^= nState >> 12;
+            nState ^= nState << 25;
+            nState ^= nState >> 27;
+            int nRoll = 1 + static_cast<int>((((nState * 0x2545f4914f6cdd1dull) >> 32) * 6) >> 32);
+            record.nRounds += nPlayer == 0;
+            int nNewPos = aPosition[nPlayer] + nRoll;
+            if (nNewPos == 100)
+                break;
+            if (nNewPos < 100)
+            {
+                int nJump = m_aJump[nNewPos];
+                record.nSnakeHits += nJump < nNewPos;
+                record.nLadderHits += nJump > nNewPos;
+                aPosition[nPlayer] = nJump;
+            }
+            nPlayer = 1 - nPlayer;
+        }
+        record.nWinner = static_cast<uint8_t>(nPlayer);
+        return record;
+    }
+
+private:
+    int m_aJump[101];
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main(int argc, char **argv)
+{
+    uint64_t nGames = argc > 1 ? std::stoull(argv[1]) : 10000000ull;
+    std::string szPath = argc > 2 ? argv[2] : "/tmp/snake_and_ladder_games.slcr";
+    unsigned nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    /* Write: every worker simulates a contiguous range of games and appends to its own row groups. */
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nBytes = 0;
+    {
+        ColumnarWriter writer(szPath);
+        if (!writer.IsOpen())
+        {
+            std::cout << "Could not open " << szPath << "\n";
+            return 1;
+        }
+        GameRecorder recorder;
+        std::vector<std::thread> vWorkers;
+        for (unsigned t = 0; t < nThreads; ++t)
+        {
+            vWorkers.emplace_back([&, t]
+                                  {
+                ColumnarWriter::Appender appender(writer);
+                uint64_t nBegin = nGames * t / nThreads, nEnd = nGames * (t + 1) / nThreads;
+                for (uint64_t game = nBegin; game < nEnd; ++game)
+                    appender.Append(recorder.Play(game)); });
+        }
+        for (auto &worker : vWorkers)
+            worker.join();
+        if (!writer.Close())
+        {
+            std::cout << "Could not write " << szPath << "\n";
+            return 1;
+        }
+        nBytes = writer.BytesWritten();
+    }
+    double dWriteSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double dRawBytes = double(nGames) * (8 + 1 + 4 + 2 + 2);
+    std::cout << "=== Wrote " << nGames << " games in " << dWriteSeconds << " s, " << nBytes / (1024.0 * 1024.0)
+              << " MB (" << dRawBytes / nBytes << "x smaller than fixed width rows) ===\n";
+
+    ColumnarReader reader(szPath);
+    if (!reader.IsOpen())
+    {
+        std::cout << "Could not read " << szPath << ": " << reader.Error() << "\n";
+        return 1;
+    }
+    for (size_t column = 0; column < Schema::ColumnCount; ++column)
+    {
+        if (reader.ColumnIndex(Schema::GameColumns()[column].szName) != int(column))
+        {
+            std::cout << "Could not read " << szPath << ": its columns are not the game columns\n";
+            return 1;
+        }
+    }
+
+    /* Projected scan: only the winner and rounds columns are decoded. */
+    struct Totals
+    {
+        uint64_t nRows = 0, nRounds = 0, nSecondWins = 0, nSnakeHits = 0, nLadderHits = 0, nIdSum = 0;
+        char aPadding[64]; // keep per-thread totals on separate cache lines
+    };
+    std::vector<Totals> vTotals(nThreads);
+    start = std::chrono::steady_clock::now();
+    reader.Scan({"winner", "rounds"}, nThreads, [&](unsigned nThread, const ColumnarReader::Batch &batch)
+                {
+        Totals &totals = vTotals[nThread];
+        const uint64_t *pWinner = batch.vColumns[Schema::Winner].data();
+        const uint64_t *pRounds = batch.vColumns[Schema::Rounds].data();
+        for (size_t row = 0; row < batch.nRows; ++row)
+        {
+            totals.nSecondWins += pWinner[row];
+            totals.nRounds += pRounds[row];
+        }
+        totals.nRows += batch.nRows; });
+    double dScanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Totals sum;
+    for (const auto &totals : vTotals)
+    {
+        sum.nRows += totals.nRows;
+        sum.nRounds += totals.nRounds;
+        sum.nSecondWins += totals.nSecondWins;
+    }
+    std::cout << "Projected scan (winner, rounds): " << sum.nRows / dScanSeconds / 1e6 << " M rows/s, mean rounds "
+              << double(sum.nRounds) / sum.nRows << ", first player wins "
+              << 100.0 * (sum.nRows - sum.nSecondWins) / sum.nRows << "%\n";
+
+    vTotals.assign(nThreads, Totals{});
+    start = std::chrono::steady_clock::now();
+    reader.Scan({"game_id", "winner", "rounds", "snake_hits", "ladder_hits"}, nThreads,
+                [&](unsigned nThread, const ColumnarReader::Batch &batch)
+                {
+        Totals &totals = vTotals[nThread];
+        for (size_t row = 0; row < batch.nRows; ++row)
+        {
+            totals.nIdSum += batch.vColumns[Schema::GameId][row];
+            totals.nSnakeHits += batch.vColumns[Schema::SnakeHits][row];
+            totals.nLadderHits += batch.vColumns[Schema::LadderHits][row];
+        }
+        totals.nRows += batch.nRows; });
+    dScanSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sum = Totals{};
+    for (const auto &totals : vTotals)
+    {
+        sum.nRows += totals.nRows;
+        sum.nIdSum += totals.nIdSum;
+        sum.nSnakeHits += totals.nSnakeHits;
+        sum.nLadderHits += totals.nLadderHits;
+    }
+    bool bIdsComplete = sum.nRows == nGames && sum.nIdSum == (nGames * (nGames - 1)) / 2;
+    std::cout << "Full scan: " << sum.nRows / dScanSeconds / 1e6 << " M rows/s, snake hits per game "
+              << double(sum.nSnakeHits) / sum.nRows << ", ladder hits per game " << double(sum.nLadderHits) / sum.nRows
+              << (bIdsComplete ? ", all game ids present\n" : ", game ids MISSING\n");
+    return bIdsComplete ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/*
+ * Hot swappable Snake and Ladder boards.
+ * Boards are compiled into immutable, versioned jump tables and published through an atomic pointer.
+ * A game pins the current version when it starts and plays its whole game on it; new games pick up
+ * whatever version is current at that moment. GetNewPosition is a plain table read, readers never lock.
+ *
+ * Old versions are reclaimed with epoch based reclamation: a pinned reader announces the global epoch it
+ * entered in, a replaced board is retired with the epoch of its replacement, and it is freed once every
+ * pinned reader has announced a later epoch.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../common/epoch_manager.h"
+
+/* BOARD LOGIC */
+class CompiledBoard
+{
+public:
+    CompiledBoard(uint64_t nVersion, int nSize, const std::map<int, int> &mSnakes, const std::map<int, int> &mLadders)
+        : m_nVersion(nVersion), m_vJump(nSize + 1)
+    {
+        for (int cell = 0; cell <= nSize; ++cell)
+            m_vJump[cell] = cell;
+        for (const auto &jumps : {mSnakes, mLadders})
+            for (const auto &jump : jumps)
+                m_vJump[jump.first] = jump.second;
+    }
+
+    uint64_t Version() const { return m_nVersion; }
+    int Size() const { return static_cast<int>(m_vJump.size()) - 1; }
+    int GetNewPosition(int nPosition) const { return m_vJump[nPosition]; }
+
+private:
+    uint64_t m_nVersion;
+    std::vector<int> m_vJump;
+};
+
+/* Owns the current board version. Reads are a single atomic load; publishing retires the previous version. */
+class BoardRegistry
+{
+public:
+    BoardRegistry(EpochManager &epochs, int nSize, const std::map<int, int> &mSnakes, const std::map<int, int> &mLadders)
+        : m_Epochs(epochs), m_pCurrent(new CompiledBoard(1, nSize, mSnakes, mLadders)) {}
+
+    ~BoardRegistry() { delete m_pCurrent.load(); }
+
+    /* Only valid while the caller holds an EpochManager::Guard. */
+    const CompiledBoard *Current() const { return m_pCurrent.load(std::memory_order_acquire); }
+
+    uint64_t Publish(int nSize, const std::map<int, int> &mSnakes, const std::map<int, int> &mLadders)
+    {
+        std::lock_guard<std::mutex> lock(m_PublishMutex);
+        uint64_t nVersion = Current()->Version() + 1;
+        const CompiledBoard *pOld = m_pCurrent.exchange(new CompiledBoard(nVersion, nSize, mSnakes, mLadders),
+                                                        std::memory_order_seq_cst);
+        m_Epochs.Retire([onReclaim = m_OnReclaim, pOld]
+                        {
+            if (onReclaim)
+                onReclaim(*pOld);
+            delete pOld; });
+        return nVersion;
+    }
+
+    void OnReclaim(std::function<void(const CompiledBoard &)> callback) { m_OnReclaim = std::move(callback); }
+
+private:
+    EpochManager &m_Epochs;
+    std::atomic<const CompiledBoard *> m_pCurrent;
+    std::mutex m_PublishMutex; // serialises writers only
+    std::function<void(const CompiledBoard &)> m_OnReclaim;
+};
+
+/* GAME LOGIC */
+class Game
+{
+public:
+    /* Plays one two player game start to finish on a single board version. Returns the number of turns. */
+    static int Play(const CompiledBoard &board, uint64_t &nRandomState)
+    {
+        int aPosition[2] = {0, 0};
+        int nPlayer = 0, nTurns = 0;
+        const int nLast = board.Size();
+        while (nTurns < 100000)
+        {
+            ++nTurns;
+            nRandomState ^= nRandomState >> 12;
+            nRandomState ^= nRandomState << 25;
+            nRandomState ^= nRandomState >> 27;
+            int nRoll = 1 + static_cast<int>((((nRandomState * 0x2545f4914f6cdd1dull) >> 32) * 6) >> 32);
+            int nNewPos = aPosition[nPlayer] + nRoll;
+            if (nNewPos == nLast)
+                break;
+            if (nNewPos < nLast)
+                aPosition[nPlayer] = board.GetNewPosition(nNewPos);
+            nPlayer = 1 - nPlayer;
+        }
+        return nTurns;
+    }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    constexpr uint64_t kVersions = 50;
+    EpochManager epochs;
+    BoardRegistry registry(epochs, 100,
+                           std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}},
+                           std::map<int, int>{{3, 24}, {21, 43}, {47, 87}, {75, 95}});
+
+    /* Demo bookkeeping only: which versions were freed, and how many games each version served. */
+    std::array<std::atomic<bool>, kVersions + 2> aFreed{};
+    std::array<std::atomic<uint64_t>, kVersions + 2> aGames{};
+    std::atomic<uint64_t> nUseAfterFree{0};
+    registry.OnReclaim([&](const CompiledBoard &board)
+                       { aFreed[board.Version()] = true; });
+
+    std::atomic<bool> bRunning{true};
+    std::vector<std::thread> vPlayers;
+    unsigned nThreads = std::max(2u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < nThreads; ++t)
+    {
+        vPlayers.emplace_back([&, t]
+                              {
+            uint64_t nRandomState = 0x9e3779b97f4a7c15ull * (t + 1);
+            while (bRunning.load(std::memory_order_relaxed))
+            {
+                auto guard = epochs.Pin();
+                const CompiledBoard *pBoard = registry.Current();
+                Game::Play(*pBoard, nRandomState);
+                if (aFreed[pBoard->Version()].load())
+                    ++nUseAfterFree;
+                aGames[pBoard->Version()].fetch_add(1, std::memory_order_relaxed);
+            } });
+    }
+
+    /* Writer: keep moving one snake's tail while the players keep playing. */
+    for (uint64_t version = 2; version <= kVersions; ++version)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        int nTail = 1 + static_cast<int>(version % 40);
+        registry.Publish(100,
+                         std::map<int, int>{{99, nTail}, {92, 55}, {77, 32}, {44, 25}, {24, 3}},
+                         std::map<int, int>{{3, 24}, {21, 43}, {47, 87}, {75, 95}});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    bRunning = false;
+    for (auto &player : vPlayers)
+        player.join();
+    epochs.Collect();
+
+    uint64_t nTotalGames = 0, nFreedVersions = 0;
+    for (uint64_t version = 1; version <= kVersions; ++version)
+    {
+        nTotalGames += aGames[version];
+        nFreedVersions += aFreed[version];
+    }
+    std::cout << "=== " << nTotalGames << " games across " << kVersions << " board versions on " << nThreads
+              << " threads ===\n";
+    std::cout << "Games on version 1: " << aGames[1] << ", on version " << kVersions << ": " << aGames[kVersions] << "\n";
+    std::cout << "Reclaimed versions: " << nFreedVersions << ", still pending: " << epochs.PendingCount() << "\n";
+    std::cout << "Games that saw their board freed underneath them: " << nUseAfterFree << "\n";
+    return nUseAfterFree == 0 ? 0 : 1;
+}
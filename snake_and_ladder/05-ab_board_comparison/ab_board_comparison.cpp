@@ -0,0 +1,261 @@
+/*
+ * Paired A/B comparison of two Snake and Ladder boards using common random numbers.
+ * Game i on board A and game i on board B are driven by the same dice streams. A roll is keyed by
+ * (player, cell the token stands on, how many times that player has rolled from that cell): within one game
+ * every key is used once, so rolls are still independent and fair, but the pair shares every roll until the
+ * boards send a token to different cells. After that, a diverged token that reaches a cell its twin has
+ * already rolled from gets the same roll its twin got, so the two paths tend to merge again instead of
+ * drifting apart for the rest of the game.
+ * The difference in game length is then measured per pair, which removes most of the dice noise that two
+ * independent runs would have to average away.
+ *
+ * The report gives the mean paired difference with a 95% confidence interval, the same estimate from two
+ * independent runs, how many games each approach needs for a given interval width, and a sequential run that
+ * stops as soon as the answer is clear, with an interval that stays valid under that stopping rule.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/* BOARD LOGIC */
+class Board
+{
+public:
+    /* Throws std::invalid_argument for a board under 2 squares and for jumps that start or end off the board. */
+    Board(std::string szName, int nSize, const std::map<int, int> &mSnakes, const std::map<int, int> &mLadders)
+        : m_szName(std::move(szName))
+    {
+        if (nSize < 2)
+            throw std::invalid_argument("a board needs at least 2 squares, not " + std::to_string(nSize));
+        m_vJump.resize(nSize + 1);
+        for (int cell = 0; cell <= nSize; ++cell)
+            m_vJump[cell] = cell;
+        for (const auto &jumps : {mSnakes, mLadders})
+        {
+            for (const auto &jump : jumps)
+            {
+                if (jump.first <= 0 || jump.first >= nSize || jump.second < 0 || jump.second > nSize)
+                    throw std::invalid_argument("jump " + std::to_string(jump.first) + " -> " +
+                                                std::to_string(jump.second) + " is off a board of " +
+                                                std::to_string(nSize) + " squares");
+                m_vJump[jump.first] = jump.second;
+            }
+        }
+    }
+
+    const std::string &GetName() const { return m_szName; }
+    int Size() const { return static_cast<int>(m_vJump.size()) - 1; }
+    int GetNewPosition(int nPosition) const { return m_vJump[nPosition]; }
+
+private:
+    std::string m_szName;
+    std::vector<int> m_vJump;
+};
+
+/* DICE LOGIC */
+/* A roll is a pure function of (seed, stream, cell, visit), so two games can replay the same stream. */
+class DiceStream
+{
+public:
+    DiceStream(uint64_t nSeed, uint64_t nStream) : m_nKey(nSeed ^ (nStream * 0x9e3779b97f4a7c15ull)) {}
+
+    int RollDice(int nCell, uint32_t nVisit) const
+    {
+        uint64_t nValue = m_nKey + ((uint64_t(nVisit) << 16 | uint64_t(nCell)) + 1) * 0xd1b54a32d192ed03ull;
+        nValue = (nValue ^ (nValue >> 30)) * 0xbf58476d1ce4e5b9ull;
+        nValue = (nValue ^ (nValue >> 27)) * 0x94d049bb133111ebull;
+        nValue ^= nValue >> 31;
+        return 1 + static_cast<int>(((nValue >> 32) * 6) >> 32);
+    }
+
+private:
+    uint64_t m_nKey;
+};
+
+/* GAME LOGIC */
+class Game
+{
+public:
+    /* Two players alternate, each on their own dice stream; returns the turns until somebody lands on the last cell. */
+    static int Play(const Board &board, const DiceStream &dice0, const DiceStream &dice1)
+    {
+        const DiceStream *aDice[2] = {&dice0, &dice1};
+        const int nLast = board.Size();
+        thread_local std::vector<uint32_t> vVisits;
+        vVisits.assign(2 * (nLast + 1), 0);
+
+        int aPosition[2] = {0, 0};
+        int nPlayer = 0, nTurns = 0;
+        while (nTurns < 100000)
+        {
+            ++nTurns;
+            const int nCell = aPosition[nPlayer];
+            const int nNewPos = nCell + aDice[nPlayer]->RollDice(nCell, vVisits[nPlayer * (nLast + 1) + nCell]++);
+            if (nNewPos == nLast)
+                break;
+            if (nNewPos < nLast)
+                aPosition[nPlayer] = board.GetNewPosition(nNewPos);
+            nPlayer = 1 - nPlayer;
+        }
+        return nTurns;
+    }
+};
+
+/* STATISTICS */
+class RunningStats
+{
+public:
+    void Add(double dValue)
+    {
+        ++m_nCount;
+        double dDelta = dValue - m_dMean;
+        m_dMean += dDelta / m_nCount;
+        m_dM2 += dDelta * (dValue - m_dMean);
+    }
+
+    uint64_t Count() const { return m_nCount; }
+    double Mean() const { return m_dMean; }
+    double Variance() const { return m_nCount > 1 ? m_dM2 / (m_nCount - 1) : 0.0; }
+    double StandardError() const { return m_nCount > 0 ? std::sqrt(Variance() / m_nCount) : 0.0; }
+
+private:
+    uint64_t m_nCount = 0;
+    double m_dMean = 0.0;
+    double m_dM2 = 0.0;
+};
+
+/* A/B COMPARISON */
+class ABComparison
+{
+public:
+    static constexpr double kZ95 = 1.959963984540054;
+
+    struct Estimate
+    {
+        double dMeanDifference = 0.0; // mean turns on A minus mean turns on B
+        double dHalfWidth = 0.0;      // 95% confidence interval is mean +- half width
+        double dVariance = 0.0;       // per game (or per pair) variance of the estimate's summand
+        uint64_t nGames = 0;          // games played per board
+
+        uint64_t GamesForHalfWidth(double dTarget) const
+        {
+            return static_cast<uint64_t>(std::ceil(dVariance * (kZ95 / dTarget) * (kZ95 / dTarget)));
+        }
+    };
+
+    /* Common random numbers: pair i plays both boards on the player streams 2i and 2i + 1. */
+    static double PlayPair(const Board &boardA, const Board &boardB, uint64_t nPair, uint64_t nSeed)
+    {
+        const DiceStream dice0(nSeed, 2 * nPair), dice1(nSeed, 2 * nPair + 1);
+        return double(Game::Play(boardA, dice0, dice1)) - Game::Play(boardB, dice0, dice1);
+    }
+
+    static Estimate Paired(const Board &boardA, const Board &boardB, uint64_t nPairs, uint64_t nSeed)
+    {
+        RunningStats difference;
+        for (uint64_t pair = 0; pair < nPairs; ++pair)
+            difference.Add(PlayPair(boardA, boardB, pair, nSeed));
+        return Estimate{difference.Mean(), kZ95 * difference.StandardError(), difference.Variance(), nPairs};
+    }
+
+    /* Baseline: the two boards get unrelated dice streams. */
+    static Estimate Independent(const Board &boardA, const Board &boardB, uint64_t nGames, uint64_t nSeed)
+    {
+        RunningStats turnsA, turnsB;
+        for (uint64_t game = 0; game < nGames; ++game)
+        {
+            turnsA.Add(Game::Play(boardA, DiceStream(nSeed, 4 * game), DiceStream(nSeed, 4 * game + 1)));
+            turnsB.Add(Game::Play(boardB, DiceStream(nSeed, 4 * game + 2), DiceStream(nSeed, 4 * game + 3)));
+        }
+        double dVariance = turnsA.Variance() + turnsB.Variance();
+        return Estimate{turnsA.Mean() - turnsB.Mean(), kZ95 * std::sqrt(dVariance / nGames), dVariance, nGames};
+    }
+
+    /*
+     * Adds pairs in blocks, never more than nMaxPairs in all, until the interval excludes zero or is narrower than
+     * dHalfWidth.
+     * Looking after every block and stopping on the first look that decides would make an ordinary 95% interval
+     * cover too rarely, so the error is spent across the looks: look k uses level alpha * 6 / (pi^2 k^2), which
+     * sums to alpha over all looks. The interval returned therefore holds with 95% probability whenever the run
+     * stops, at the price of being wider than a fixed sample interval with the same number of pairs.
+     */
+    static Estimate PairedUntilDecided(const Board &boardA, const Board &boardB, double dHalfWidth, uint64_t nMaxPairs,
+                                       uint64_t nSeed)
+    {
+        const double kPi = 3.14159265358979323846;
+        RunningStats difference;
+        const uint64_t nBlock = 1000;
+        double dZ = kZ95;
+        for (uint64_t nLook = 1; difference.Count() < nMaxPairs; ++nLook)
+        {
+            uint64_t nThisBlock = std::min(nBlock, nMaxPairs - difference.Count());
+            for (uint64_t i = 0; i < nThisBlock; ++i)
+                difference.Add(PlayPair(boardA, boardB, difference.Count(), nSeed));
+            dZ = NormalQuantileAbove(0.05 * 6.0 / (kPi * kPi * double(nLook) * double(nLook)) / 2.0);
+            double dCurrent = dZ * difference.StandardError();
+            if (dCurrent < dHalfWidth || std::fabs(difference.Mean()) > dCurrent)
+                break;
+        }
+        return Estimate{difference.Mean(), dZ * difference.StandardError(), difference.Variance(), difference.Count()};
+    }
+
+private:
+    /* z with P(Z > z) = dTail for a standard normal Z, by bisection on erfc. */
+    static double NormalQuantileAbove(double dTail)
+    {
+        double dLow = 0.0, dHigh = 40.0;
+        for (int i = 0; i < 100; ++i)
+        {
+            double dMid = 0.5 * (dLow + dHigh);
+            if (0.5 * std::erfc(dMid / std::sqrt(2.0)) > dTail)
+                dLow = dMid;
+            else
+                dHigh = dMid;
+        }
+        return 0.5 * (dLow + dHigh);
+    }
+};
+
+/*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+int main()
+{
+    const std::map<int, int> mLadders{{3, 24}, {21, 43}, {47, 87}, {75, 95}};
+    Board boardA("Classic", 100, std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}}, mLadders);
+    Board boardB("Snake at 44 ending at 22", 100, std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 22}, {24, 3}}, mLadders);
+
+    const uint64_t nGames = 200000;
+    const uint64_t nSeed = 2024;
+    std::cout << "=== " << boardA.GetName() << " vs " << boardB.GetName() << ", " << nGames << " games per board ===\n";
+
+    auto print = [](const char *szLabel, const ABComparison::Estimate &estimate)
+    {
+        std::cout << szLabel << ": A - B = " << estimate.dMeanDifference << " turns, 95% CI ["
+                  << estimate.dMeanDifference - estimate.dHalfWidth << ", "
+                  << estimate.dMeanDifference + estimate.dHalfWidth << "], "
+                  << estimate.nGames << " games per board\n";
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    ABComparison::Estimate paired = ABComparison::Paired(boardA, boardB, nGames, nSeed);
+    ABComparison::Estimate independent = ABComparison::Independent(boardA, boardB, nGames, nSeed);
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    print("Paired     ", paired);
+    print("Independent", independent);
+
+    const double dTarget = 0.5;
+    std::cout << "Variance reduction: " << independent.dVariance / paired.dVariance << "x\n";
+    std::cout << "Games per board for a +-" << dTarget << " turn interval: paired " << paired.GamesForHalfWidth(dTarget)
+              << ", independent " << independent.GamesForHalfWidth(dTarget) << "\n";
+
+    ABComparison::Estimate decided = ABComparison::PairedUntilDecided(boardA, boardB, dTarget, nGames, nSeed + 1);
+    print("Sequential ", decided); // interval adjusted for stopping on the first decisive look
+    std::cout << "(" << dSeconds << " s for the fixed size runs)\n";
+    return 0;
+}
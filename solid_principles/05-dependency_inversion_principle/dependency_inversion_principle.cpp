@@ -1,6 +1,16 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <string>
 #include <vector>
 
 /* DICE LOGIC */
@@ -22,6 +32,19 @@ public:
         return dis(gen);
     }
 };
+class SeededDice : public IDice
+{
+public:
+    SeededDice(unsigned nSeed) : m_Generator(nSeed), m_Distribution(1, 6) {}
+    int RollDice() override
+    {
+        return m_Distribution(m_Generator);
+    }
+
+private:
+    std::mt19937 m_Generator;                       // Reproducible, for regression runs
+    std::uniform_int_distribution<> m_Distribution; // Range [1, 6]
+};
 class BiasedDice : public IDice
 {
     // maybe Favoiring certain no
@@ -31,6 +54,107 @@ class LoadedDice : public IDice
     // Maybe More 6's
 };
 
+/* INPUT LOGIC */
+class IInputSource
+{
+public:
+    virtual ~IInputSource() {};
+    // Returns once the player pressed ENTER, or false when no more input will ever come
+    virtual bool WaitForKeypress() = 0;
+};
+
+class ConsoleInput : public IInputSource
+{
+public:
+    bool WaitForKeypress() override
+    {
+        return std::cin.get() != EOF;
+    }
+};
+
+class EventLoopInput : public IInputSource
+{
+public:
+    // onIdle runs every nTickMs while no key is pressed, so the process keeps doing useful work
+    EventLoopInput(std::function<void()> onIdle = {}, int nTickMs = 50) : m_OnIdle(std::move(onIdle)), m_nTickMs(nTickMs) {}
+
+    bool WaitForKeypress() override
+    {
+        while (true)
+        {
+            pollfd stdinFd{STDIN_FILENO, POLLIN, 0};
+            int nReady = poll(&stdinFd, 1, m_nTickMs);
+            if (nReady < 0 && errno != EINTR)
+                return false;
+            if (nReady > 0)
+            {
+                char c = 0;
+                if (read(STDIN_FILENO, &c, 1) <= 0)
+                    return false;
+                if (c == '\n')
+                    return true;
+                continue;
+            }
+            if (m_OnIdle)
+                m_OnIdle();
+        }
+    }
+
+private:
+    std::function<void()> m_OnIdle;
+    int m_nTickMs;
+};
+
+class ScriptedInput : public IInputSource
+{
+public:
+    // Every '\n' in szKeypresses is one ENTER press; bRepeat replays the script forever
+    ScriptedInput(std::string szKeypresses, bool bRepeat = false) : m_szKeypresses(std::move(szKeypresses)), m_bRepeat(bRepeat) {}
+
+    // Returns nullptr when the script cannot be opened or read
+    static std::unique_ptr<ScriptedInput> FromFile(const std::string &szPath)
+    {
+        int fd = open(szPath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+        std::string szContent;
+        char aBuffer[4096];
+        ssize_t nRead = 0;
+        while ((nRead = read(fd, aBuffer, sizeof(aBuffer))) != 0)
+        {
+            if (nRead < 0 && errno == EINTR)
+                continue;
+            if (nRead < 0)
+            {
+                close(fd);
+                return nullptr;
+            }
+            szContent.append(aBuffer, static_cast<size_t>(nRead));
+        }
+        close(fd);
+        return std::make_unique<ScriptedInput>(std::move(szContent));
+    }
+
+    bool WaitForKeypress() override
+    {
+        size_t nNewLine = m_szKeypresses.find('\n', m_nOffset);
+        if (nNewLine == std::string::npos && m_bRepeat && m_nOffset != 0)
+        {
+            m_nOffset = 0;
+            nNewLine = m_szKeypresses.find('\n');
+        }
+        if (nNewLine == std::string::npos)
+            return false;
+        m_nOffset = nNewLine + 1;
+        return true;
+    }
+
+private:
+    std::string m_szKeypresses;
+    bool m_bRepeat;
+    size_t m_nOffset = 0;
+};
+
 /* PLAYER LOGIC */
 class Player
 {
@@ -134,7 +258,8 @@ private:
 class Game
 {
 public:
-    Game(std::unique_ptr<IDice> dice, std::vector<std::unique_ptr<IBoardRule>> rules) : m_pDice(std::move(dice))
+    Game(std::unique_ptr<IDice> dice, std::unique_ptr<IInputSource> input, std::vector<std::unique_ptr<IBoardRule>> rules)
+        : m_pDice(std::move(dice)), m_pInput(std::move(input))
     {
         m_vPlayers.emplace_back("Player_1");
         m_vPlayers.emplace_back("Player_2");
@@ -149,7 +274,11 @@ public:
         while (true)
         {
             std::cout << "  === Round " << ++nRound << " begin's. ===\n";
-            std::cin.get();
+            if (!m_pInput->WaitForKeypress())
+            {
+                std::cout << "=== No more input, game abandoned ===\n";
+                break;
+            }
 
             Player &currentPlayer = m_vPlayers[nCurrentPlayerIndex];
             std::cout << "=== " << currentPlayer.GetName() << "'s turn ===\n";
@@ -180,22 +309,72 @@ public:
         }
     }
 
+    int GetRound() const { return nRound; }
+
 private:
     std::unique_ptr<IDice> m_pDice;
+    std::unique_ptr<IInputSource> m_pInput;
     Board m_Board;
     std::vector<Player> m_vPlayers;
     int nCurrentPlayerIndex = 0;
     int nRound = 0;
 };
 
-int main()
+std::vector<std::unique_ptr<IBoardRule>> MakeRules()
 {
-    auto dice = std::make_unique<StandardDice>();
     std::vector<std::unique_ptr<IBoardRule>> rules;
     rules.emplace_back(std::make_unique<SnakeRule>(std::map<int, int>{{99, 10}, {92, 55}, {77, 32}, {44, 25}, {24, 3}}));
     rules.emplace_back(std::make_unique<LadderRule>(std::map<int, int>{{3, 24}, {21, 43}, {47, 87}, {75, 95}}));
-    Game game(std::move(dice), std::move(rules));
+    return rules;
+}
+
+// Plays nGames seeded games with scripted ENTER presses at full speed, game output is discarded
+int RunRegression(int nGames)
+{
+    std::ostringstream discarded;
+    std::streambuf *pConsole = std::cout.rdbuf(discarded.rdbuf());
+
+    long long nTotalRounds = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < nGames; ++i)
+    {
+        Game game(std::make_unique<SeededDice>(i), std::make_unique<ScriptedInput>("\n", true), MakeRules());
+        game.PlayGame();
+        nTotalRounds += game.GetRound();
+        discarded.str("");
+    }
+    double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout.rdbuf(pConsole);
+    std::cout << nGames << " scripted games, " << nTotalRounds << " rounds in total, " << nGames / dSeconds << " games/s\n";
+    return 0;
+}
+
+// Usage: [--event-loop | --script <file> | --regression <games>]
+int main(int argc, char **argv)
+{
+    std::string szMode = argc > 1 ? argv[1] : "";
+    if (szMode == "--regression")
+        return RunRegression(argc > 2 ? std::stoi(argv[2]) : 1000);
+
+    std::unique_ptr<IInputSource> input;
+    if (szMode == "--script" && argc > 2)
+    {
+        input = ScriptedInput::FromFile(argv[2]);
+        if (!input)
+        {
+            std::cerr << "Cannot read script file: " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    else if (szMode == "--event-loop")
+        input = std::make_unique<EventLoopInput>();
+    else
+        input = std::make_unique<ConsoleInput>();
+
+    auto dice = std::make_unique<StandardDice>();
+    Game game(std::move(dice), std::move(input), MakeRules());
     game.PlayGame();
 
     return 0;
-}
\ No newline at end of file
+}